@@ -0,0 +1,391 @@
+// ddobuildsync_bench - startup/sync latency benchmarks.
+//
+// Usage: ddobuildsync_bench [--sizes 100,10000,100000] [--iterations N]
+//                           [--out results.json] [--keep]
+//
+// Generates fixture repos with the requested number of .DDOBuild files under
+// %TEMP%\ddobuildsync_bench and times the same code paths the app runs on
+// startup and during an hourly sync. Results are written as JSON so runs from
+// different versions can be compared.
+
+#include "git_manager.h"
+#include "build_diff.h"
+#include "config.h"
+#include "updater.h"
+#include "utils.h"
+#include "transcode.h"
+#include "xml_canonical.h"
+#include <nlohmann/json.hpp>
+#include <windows.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+struct BenchResult {
+    std::string name;
+    int fixtureFiles = 0;          // 0 for fixture-independent benchmarks
+    std::vector<double> samplesMs;
+};
+
+static std::vector<BenchResult> g_results;
+static int g_iterations = 10;
+
+// One-shot operations (first-time setup) pass warmUp = false: a second
+// call would measure something else
+static void Measure(const std::string& name, int fixtureFiles, int iterations,
+                    const std::function<void()>& fn, bool warmUp = true) {
+    BenchResult r;
+    r.name = name;
+    r.fixtureFiles = fixtureFiles;
+
+    if (warmUp) fn();  // not recorded
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        r.samplesMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    std::fprintf(stderr, "  %-28s files=%-7d %d run(s)\n", name.c_str(), fixtureFiles, iterations);
+    g_results.push_back(std::move(r));
+}
+
+static json ResultToJson(const BenchResult& r) {
+    std::vector<double> s = r.samplesMs;
+    std::sort(s.begin(), s.end());
+    double sum = 0;
+    for (double v : s) sum += v;
+
+    auto pct = [&s](double p) {
+        if (s.empty()) return 0.0;
+        size_t idx = static_cast<size_t>(p * (s.size() - 1) + 0.5);
+        return s[idx];
+    };
+
+    json j;
+    j["name"]       = r.name;
+    j["files"]      = r.fixtureFiles;
+    j["iterations"] = s.size();
+    j["mean_ms"]    = s.empty() ? 0.0 : sum / s.size();
+    j["min_ms"]     = s.empty() ? 0.0 : s.front();
+    j["p50_ms"]     = pct(0.50);
+    j["p90_ms"]     = pct(0.90);
+    j["max_ms"]     = s.empty() ? 0.0 : s.back();
+    return j;
+}
+
+// ---------- Fixtures ----------
+
+static std::string BenchRoot() {
+    char tempBuf[MAX_PATH];
+    GetTempPathA(MAX_PATH, tempBuf);
+    return std::string(tempBuf) + "ddobuildsync_bench";
+}
+
+static std::string MakeBuildXml(int index) {
+    std::ostringstream x;
+    x << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n";
+    x << "<DDOBuilderCharacterData>\r\n";
+    x << "  <Character>\r\n";
+    x << "    <Name>Bench" << index << "</Name>\r\n";
+    x << "    <Race>Human</Race>\r\n";
+    x << "    <Alignment>Lawful Good</Alignment>\r\n";
+    for (int level = 1; level <= 20; ++level) {
+        x << "    <LevelTraining><Level>" << level << "</Level><Class>Fighter</Class>"
+          << "<FeatTrained>Power Attack " << (index + level) % 7 << "</FeatTrained></LevelTraining>\r\n";
+    }
+    x << "  </Character>\r\n";
+    x << "</DDOBuilderCharacterData>\r\n";
+    return x.str();
+}
+
+static void WriteFile(const std::string& path, const std::string& content) {
+    std::ofstream f(path, std::ios::binary);
+    f << content;
+}
+
+static void RemoveTree(const std::string& dir) {
+    std::string cmd = "cmd.exe /C rmdir /S /Q \"" + dir + "\" >nul 2>nul";
+    std::system(cmd.c_str());
+}
+
+// Builds folder with `count` build files, committed, with ~1% of them modified
+static std::string CreateFixtureRepo(int count) {
+    std::string dir = BenchRoot() + "\\repo_" + std::to_string(count);
+    RemoveTree(dir);
+    CreateDirectoryA(BenchRoot().c_str(), nullptr);
+    CreateDirectoryA(dir.c_str(), nullptr);
+
+    std::fprintf(stderr, "Generating fixture with %d build files...\n", count);
+    for (int i = 0; i < count; ++i) {
+        WriteFile(dir + "\\Build" + std::to_string(i) + ".DDOBuild", MakeBuildXml(i));
+    }
+    // Some non-build files, as in a real DDO Builder install
+    WriteFile(dir + "\\DDOBuilder.exe", std::string(64 * 1024, 'x'));
+    WriteFile(dir + "\\DDOBuilder.log", "log\r\n");
+
+    // First-time setup cost (fast-import path, or add -A without an identity)
+    GitManager git;
+    git.SetWorkDir(dir);
+    Measure("init_repo", count, 1, [&]() { git.InitRepo(); }, false);
+
+    int modified = (std::max)(1, count / 100);
+    for (int i = 0; i < modified; ++i) {
+        WriteFile(dir + "\\Build" + std::to_string(i) + ".DDOBuild", MakeBuildXml(i + 1));
+    }
+    return dir;
+}
+
+static std::string CreateFixtureZip() {
+    std::string src = BenchRoot() + "\\zip_src\\DDOBuilderV2_2.0.0.99";
+    std::string zip = BenchRoot() + "\\fixture.zip";
+    RemoveTree(BenchRoot() + "\\zip_src");
+    CreateDirectoryA(BenchRoot().c_str(), nullptr);
+    CreateDirectoryA((BenchRoot() + "\\zip_src").c_str(), nullptr);
+    CreateDirectoryA(src.c_str(), nullptr);
+
+    WriteFile(src + "\\DDOBuilder.exe", std::string(4 * 1024 * 1024, 'x'));
+    for (int i = 0; i < 200; ++i) {
+        WriteFile(src + "\\data" + std::to_string(i) + ".xml", MakeBuildXml(i));
+    }
+
+    DeleteFileA(zip.c_str());
+    std::string cmd = "powershell -NoProfile -NonInteractive -Command \"Compress-Archive -Path '" +
+                      src + "' -DestinationPath '" + zip + "'\" >nul 2>nul";
+    std::system(cmd.c_str());
+    return zip;
+}
+
+static std::string MakeReleaseJson() {
+    json j;
+    j["tag_name"] = "2.0.0.99";
+    j["name"] = "DDO Builder V2 2.0.0.99";
+    j["body"] = std::string(8 * 1024, 'r');
+    j["assets"] = json::array();
+    for (int i = 0; i < 20; ++i) {
+        json a;
+        a["name"] = "extra_" + std::to_string(i) + ".txt";
+        a["browser_download_url"] = "https://example.invalid/extra_" + std::to_string(i);
+        a["size"] = 1024 * i;
+        j["assets"].push_back(a);
+    }
+    json zip;
+    zip["name"] = "DDOBuilderV2_2.0.0.99.zip";
+    zip["browser_download_url"] = "https://example.invalid/DDOBuilderV2_2.0.0.99.zip";
+    j["assets"].push_back(zip);
+    return j.dump();
+}
+
+// ---------- Benchmarks ----------
+
+static void BenchCommon() {
+    std::fprintf(stderr, "Fixture-independent benchmarks\n");
+
+    GitManager git;
+    std::string output;
+    Measure("spawn_git_version", 0, g_iterations, [&]() {
+        git.RunGit("--version", output);
+    });
+
+    std::string ascii = "[12:34:56]   Update builds - 2024-01-01 12:00:00 .DDOBuild\r\n";
+    std::string mixed = u8"Builds folder: C:\\Users\\Jörg\\Documents\\DDOBuilderV2_2.0.0.75\\Ærindel.DDOBuild";
+    std::wstring wide = Utils::ToWide(mixed);
+    Measure("to_wide_x10000", 0, g_iterations, [&]() {
+        for (int i = 0; i < 5000; ++i) {
+            Utils::ToWide(ascii);
+            Utils::ToWide(mixed);
+        }
+    });
+    Measure("to_utf8_x10000", 0, g_iterations, [&]() {
+        for (int i = 0; i < 10000; ++i) Utils::ToUtf8(wide);
+    });
+
+    // Pooled variants: the output buffer is reused, as AppendLog does
+    std::wstring wideBuf;
+    std::string utf8Buf;
+    Measure("to_wide_pooled_x10000", 0, g_iterations, [&]() {
+        for (int i = 0; i < 5000; ++i) {
+            Utils::ToWide(ascii, wideBuf);
+            Utils::ToWide(mixed, wideBuf);
+        }
+    });
+    Measure("to_utf8_pooled_x10000", 0, g_iterations, [&]() {
+        for (int i = 0; i < 10000; ++i) Utils::ToUtf8(wide, utf8Buf);
+    });
+
+    // Bulk throughput of the transcoding kernels vs. the Win32 two-pass calls
+    std::string bulkAscii;
+    while (bulkAscii.size() < 1024 * 1024) bulkAscii += ascii;
+    std::string bulkMixed;
+    while (bulkMixed.size() < 1024 * 1024) bulkMixed += mixed;
+    Measure("transcode_1mb_ascii", 0, g_iterations, [&]() {
+        Utils::ToWide(bulkAscii, wideBuf);
+        Utils::ToUtf8(wideBuf, utf8Buf);
+    });
+    Measure("transcode_1mb_mixed", 0, g_iterations, [&]() {
+        Utils::ToWide(bulkMixed, wideBuf);
+        Utils::ToUtf8(wideBuf, utf8Buf);
+    });
+    Measure("win32_1mb_ascii", 0, g_iterations, [&]() {
+        int len = MultiByteToWideChar(CP_UTF8, 0, bulkAscii.data(),
+                                      static_cast<int>(bulkAscii.size()), nullptr, 0);
+        wideBuf.resize(len);
+        MultiByteToWideChar(CP_UTF8, 0, bulkAscii.data(), static_cast<int>(bulkAscii.size()),
+                            wideBuf.data(), len);
+        int len8 = WideCharToMultiByte(CP_UTF8, 0, wideBuf.data(), len, nullptr, 0, nullptr, nullptr);
+        utf8Buf.resize(len8);
+        WideCharToMultiByte(CP_UTF8, 0, wideBuf.data(), len, utf8Buf.data(), len8, nullptr, nullptr);
+    });
+
+    std::string cfgPath = BenchRoot() + "\\bench_config.json";
+    CreateDirectoryA(BenchRoot().c_str(), nullptr);
+    ConfigManager cfg;
+    cfg.Get().buildsFolder = "C:\\Users\\bench\\Documents\\DDOBuilderV2_2.0.0.75";
+    cfg.Get().ddoBuilderExe = cfg.Get().buildsFolder + "\\DDOBuilder.exe";
+    cfg.Get().gitRepoUrl = "https://github.com/bench/ddo-builds.git";
+    Measure("config_save", 0, g_iterations, [&]() { cfg.Save(cfgPath); });
+    Measure("config_load", 0, g_iterations, [&]() { cfg.Load(cfgPath); });
+
+    Updater updater;
+    std::string release = MakeReleaseJson();
+    Measure("release_json_parse", 0, g_iterations, [&]() {
+        UpdateInfo info;
+        updater.ParseRelease(release, info);
+    });
+
+    // Clean filter cost per build file (runs on every add/status of a changed build)
+    std::string build = MakeBuildXml(7);
+    CanonicalOptions canon;
+    Measure("canonicalize_build_x100", 0, g_iterations, [&]() {
+        std::string out, error;
+        for (int i = 0; i < 100; ++i) XmlCanonical::Canonicalize(build, out, canon, error);
+    });
+
+    // What-changed summary after a pull: the feat differs at every level
+    std::string otherBuild = MakeBuildXml(8);
+    Measure("build_diff_x100", 0, g_iterations, [&]() {
+        std::vector<BuildChange> changes;
+        std::string error;
+        for (int i = 0; i < 100; ++i) {
+            changes.clear();
+            BuildDiff::Compare(build, otherBuild, changes, error);
+        }
+    });
+
+    std::string zip = CreateFixtureZip();
+    std::string extractDir = BenchRoot() + "\\zip_out";
+    Measure("zip_extract", 0, (std::max)(1, g_iterations / 5), [&]() {
+        RemoveTree(extractDir);
+        updater.ExtractZip(zip, extractDir);
+    });
+}
+
+static void BenchFixture(int files) {
+    std::string dir = CreateFixtureRepo(files);
+
+    GitManager git;
+    git.SetWorkDir(dir);
+
+    std::string statusOut;
+    git.RunGit("status --porcelain", statusOut);
+
+    Measure("git_status_count", files, g_iterations, [&]() {
+        git.GetChangedFileCount();
+    });
+
+    Measure("porcelain_parse", files, g_iterations, [&]() {
+        GitManager::CountPorcelainEntries(statusOut);
+    });
+
+    // Includes one copy of the capture per run, as Parse takes ownership
+    std::string statusV2;
+    git.RunGit("status --porcelain=v2 -z --branch", statusV2);
+    Measure("porcelain_v2_parse", files, g_iterations, [&]() {
+        ChangeSet changes;
+        GitStatus::Parse(std::string(statusV2), changes);
+    });
+
+    // Same shape as the app's log callback: copy each line and hand it off
+    size_t lines = 0;
+    git.SetLogCallback([&lines](const std::string& msg) {
+        char* copy = _strdup(msg.c_str());
+        free(copy);
+        ++lines;
+    });
+    Measure("log_pipeline", files, g_iterations, [&]() {
+        git.LogOutput(statusOut);
+    });
+    git.SetLogCallback(nullptr);
+
+    std::string output;
+    Measure("git_add_all_noop", files, g_iterations, [&]() {
+        git.RunGit("add -A --dry-run", output);
+    });
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes = {100, 10000, 100000};
+    std::string outPath;
+    bool keep = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            std::stringstream ss(argv[++i]);
+            std::string tok;
+            while (std::getline(ss, tok, ',')) {
+                try { sizes.push_back(std::stoi(tok)); } catch (...) {}
+            }
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            g_iterations = (std::max)(1, std::atoi(argv[++i]));
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (arg == "--keep") {
+            keep = true;
+        } else {
+            std::fprintf(stderr,
+                "Usage: ddobuildsync_bench [--sizes 100,10000,100000] [--iterations N]\n"
+                "                          [--out results.json] [--keep]\n");
+            return 2;
+        }
+    }
+
+    GitManager probe;
+    std::string gitVersion = probe.GetGitVersion();
+    if (gitVersion.empty()) {
+        std::fprintf(stderr, "git not found on PATH\n");
+        return 1;
+    }
+
+    BenchCommon();
+    for (int files : sizes) BenchFixture(files);
+
+    json report;
+    report["tool"]        = "ddobuildsync_bench";
+    report["timestamp"]   = Utils::GetTimestamp();
+    report["git_version"] = gitVersion;
+    report["transcode_kernel"] = Transcode::KernelName();
+    report["iterations"]  = g_iterations;
+    report["results"]     = json::array();
+    for (const auto& r : g_results) report["results"].push_back(ResultToJson(r));
+
+    std::string text = report.dump(2);
+    if (outPath.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream f(outPath);
+        f << text << std::endl;
+    }
+
+    if (!keep) RemoveTree(BenchRoot());
+    return 0;
+}
@@ -0,0 +1,422 @@
+#include "build_diff.h"
+#include "git_manager.h"
+#include "git_status.h"
+#include "trace.h"
+#include "xml_stream.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+// Deeper than any real build file; guards the recursion against junk input
+static const int kMaxDepth = 256;
+
+// Values longer than this are cut short in Describe
+static const size_t kMaxShownValue = 60;
+
+// Children or attributes that identify one of several same-named siblings
+static const char* const kIdentityFields[] = {"Level", "Name", "TreeName", "Slot", "Type"};
+
+static const char* kZeroId = "0000000000000000000000000000000000000000";
+
+namespace BuildDiff {
+
+struct Node {
+    std::string name;
+    std::string key;            // name, plus identity or occurrence if it has same-named siblings
+    std::string identity;       // "Level=5", from an identifying attribute or leaf child
+    std::string value;          // trimmed text, leaves only
+    std::vector<XmlAttribute> attributes;   // sorted by name
+    uint64_t hash = 0;
+    std::vector<uint32_t> children;
+};
+
+struct Tree {
+    std::vector<Node> nodes;    // nodes[0] is the root element
+};
+
+// FNV-1a, 64-bit
+class Hasher {
+public:
+    void Add(const std::string& s) {
+        for (char c : s) Byte(static_cast<unsigned char>(c));
+        Byte(0);
+    }
+    void Add(uint64_t v) {
+        for (int i = 0; i < 8; ++i) Byte(static_cast<unsigned char>(v >> (i * 8)));
+    }
+    uint64_t Value() const { return m_hash; }
+
+private:
+    uint64_t m_hash = 14695981039346656037ull;
+    void Byte(unsigned char b) {
+        m_hash ^= b;
+        m_hash *= 1099511628211ull;
+    }
+};
+
+static std::string Trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+static bool IsIdentityField(const std::string& name) {
+    for (const char* f : kIdentityFields) {
+        if (name == f) return true;
+    }
+    return false;
+}
+
+class TreeBuilder {
+public:
+    TreeBuilder(XmlReader& reader, Tree& tree, std::string& error)
+        : m_reader(reader), m_tree(tree), m_error(error) {}
+
+    bool Build() {
+        XmlToken tok;
+        bool sawRoot = false;
+        while (m_reader.Next(tok)) {
+            if (tok.type == XmlTokenType::StartElement) {
+                if (sawRoot) return Fail("more than one root element");
+                sawRoot = true;
+                uint32_t root;
+                if (!ReadElement(tok, 0, root)) return false;
+            } else if (tok.type == XmlTokenType::EndElement) {
+                return Fail("unmatched </" + tok.name + ">");
+            }
+        }
+        if (m_reader.HasError()) return Fail(m_reader.Error());
+        if (!sawRoot) return Fail("no root element");
+        return true;
+    }
+
+private:
+    XmlReader& m_reader;
+    Tree& m_tree;
+    std::string& m_error;
+
+    bool Fail(const std::string& msg) {
+        if (m_error.empty()) m_error = msg;
+        return false;
+    }
+
+    bool ReadElement(const XmlToken& start, int depth, uint32_t& index) {
+        if (depth > kMaxDepth) return Fail("elements nested too deeply");
+
+        index = static_cast<uint32_t>(m_tree.nodes.size());
+        m_tree.nodes.emplace_back();
+        m_tree.nodes[index].name = start.name;
+
+        Hasher h;
+        h.Add(start.name);
+        std::string identity;
+        std::vector<const XmlAttribute*> attrs;
+        for (const auto& a : start.attributes) attrs.push_back(&a);
+        std::sort(attrs.begin(), attrs.end(), [](const XmlAttribute* a, const XmlAttribute* b) {
+            return a->name < b->name;
+        });
+        std::vector<XmlAttribute> sortedAttrs;
+        for (const XmlAttribute* a : attrs) {
+            h.Add(a->name);
+            h.Add(a->value);
+            if (identity.empty() && IsIdentityField(a->name)) identity = a->name + "=" + a->value;
+            sortedAttrs.push_back(*a);
+        }
+
+        std::string text;
+        std::vector<uint32_t> children;
+        XmlToken tok;
+        for (;;) {
+            if (!m_reader.Next(tok)) {
+                if (m_reader.HasError()) return Fail(m_reader.Error());
+                return Fail("unexpected end of document inside <" + start.name + ">");
+            }
+            if (tok.type == XmlTokenType::EndElement) break;
+            if (tok.type == XmlTokenType::Text) {
+                text += tok.text;
+            } else if (tok.type == XmlTokenType::StartElement) {
+                uint32_t child;
+                if (!ReadElement(tok, depth + 1, child)) return false;
+                children.push_back(child);
+            }
+        }
+
+        // nodes may have reallocated while reading children
+        Node& node = m_tree.nodes[index];
+        node.attributes = std::move(sortedAttrs);
+        if (children.empty()) {
+            node.value = Trim(text);
+            h.Add(node.value);
+        }
+
+        for (uint32_t c : children) {
+            const Node& child = m_tree.nodes[c];
+            if (identity.empty() && child.children.empty() && IsIdentityField(child.name)) {
+                identity = child.name + "=" + child.value;
+            }
+            h.Add(child.hash);
+        }
+        node.identity = identity;
+        node.key = node.name;
+
+        // Repeated children are keyed by what identifies them, else by order
+        std::map<std::string, int> names;
+        for (uint32_t c : children) names[m_tree.nodes[c].name]++;
+        std::map<std::string, int> seen;
+        for (uint32_t c : children) {
+            Node& child = m_tree.nodes[c];
+            child.key = child.name;
+            if (names[child.name] > 1 && !child.identity.empty()) child.key += "[" + child.identity + "]";
+            int n = ++seen[child.key];
+            if (n > 1) child.key += "#" + std::to_string(n);
+        }
+        node.children = std::move(children);
+        node.hash = h.Value();
+        return true;
+    }
+};
+
+static bool BuildTree(const std::string& xml, Tree& tree, std::string& error) {
+    std::istringstream in(xml);
+    XmlReader reader(in);
+    TreeBuilder builder(reader, tree, error);
+    return builder.Build();
+}
+
+static void AddChange(BuildChange::Kind kind, const std::string& path, const std::string& oldValue,
+                      const std::string& newValue, std::vector<BuildChange>& out) {
+    BuildChange c;
+    c.kind = kind;
+    c.path = path;
+    c.oldValue = oldValue;
+    c.newValue = newValue;
+    out.push_back(std::move(c));
+}
+
+// Attribute changes of one element, as "<path>/@<name>"; both lists are sorted
+static void DiffAttributes(const Node& na, const Node& nb, const std::string& path,
+                           std::vector<BuildChange>& out) {
+    std::string prefix = path.empty() ? "@" : path + "/@";
+    size_t i = 0, j = 0;
+    while (i < na.attributes.size() || j < nb.attributes.size()) {
+        const XmlAttribute* x = i < na.attributes.size() ? &na.attributes[i] : nullptr;
+        const XmlAttribute* y = j < nb.attributes.size() ? &nb.attributes[j] : nullptr;
+        if (x && (!y || x->name < y->name)) {
+            AddChange(BuildChange::Kind::Removed, prefix + x->name, x->value, "", out);
+            ++i;
+        } else if (y && (!x || y->name < x->name)) {
+            AddChange(BuildChange::Kind::Added, prefix + y->name, "", y->value, out);
+            ++j;
+        } else {
+            if (x->value != y->value) AddChange(BuildChange::Kind::Changed, prefix + x->name, x->value, y->value, out);
+            ++i;
+            ++j;
+        }
+    }
+}
+
+static void DiffNodes(const Tree& a, uint32_t ai, const Tree& b, uint32_t bi,
+                      const std::string& path, std::vector<BuildChange>& out) {
+    const Node& na = a.nodes[ai];
+    const Node& nb = b.nodes[bi];
+    if (na.hash == nb.hash) return;
+
+    // A section that became a leaf (or the reverse) is a different element
+    if (na.children.empty() != nb.children.empty()) {
+        AddChange(BuildChange::Kind::Removed, path, na.value, "", out);
+        AddChange(BuildChange::Kind::Added, path, "", nb.value, out);
+        return;
+    }
+
+    DiffAttributes(na, nb, path, out);
+    if (na.children.empty()) {
+        if (na.value != nb.value) AddChange(BuildChange::Kind::Changed, path, na.value, nb.value, out);
+        return;
+    }
+
+    auto childPath = [&path](const Node& n) { return path.empty() ? n.key : path + "/" + n.key; };
+
+    std::map<std::string, uint32_t> newByKey;
+    for (uint32_t c : nb.children) newByKey[b.nodes[c].key] = c;
+
+    std::map<std::string, bool> matched;
+    for (uint32_t c : na.children) {
+        const Node& child = a.nodes[c];
+        auto it = newByKey.find(child.key);
+        if (it == newByKey.end()) {
+            BuildChange r;
+            r.kind = BuildChange::Kind::Removed;
+            r.path = childPath(child);
+            r.oldValue = child.value;
+            out.push_back(std::move(r));
+            continue;
+        }
+        matched[child.key] = true;
+        DiffNodes(a, c, b, it->second, childPath(child), out);
+    }
+    for (uint32_t c : nb.children) {
+        const Node& child = b.nodes[c];
+        if (matched.count(child.key)) continue;
+        BuildChange r;
+        r.kind = BuildChange::Kind::Added;
+        r.path = childPath(child);
+        r.newValue = child.value;
+        out.push_back(std::move(r));
+    }
+}
+
+static std::string Shorten(const std::string& value) {
+    if (value.size() <= kMaxShownValue) return value;
+    return value.substr(0, kMaxShownValue - 3) + "...";
+}
+
+bool Compare(const std::string& oldXml, const std::string& newXml,
+             std::vector<BuildChange>& out, std::string& error) {
+    error.clear();
+    Tree a, b;
+    if (!BuildTree(oldXml, a, error)) {
+        error = "old version: " + error;
+        return false;
+    }
+    if (!BuildTree(newXml, b, error)) {
+        error = "new version: " + error;
+        return false;
+    }
+
+    // The root's own name is the same in every build; paths start below it
+    DiffNodes(a, 0, b, 0, "", out);
+    return true;
+}
+
+const char* Category(const std::string& path) {
+    // Checked in this order: a feat picked at a level-up counts as a feat
+    if (path.find("Feat") != std::string::npos)        return "feat";
+    if (path.find("Enhancement") != std::string::npos ||
+        path.find("Destiny") != std::string::npos ||
+        path.find("Reaper") != std::string::npos)      return "enhancement";
+    if (path.find("Gear") != std::string::npos ||
+        path.find("Item") != std::string::npos ||
+        path.find("Slot") != std::string::npos)        return "gear";
+    if (path.find("Level") != std::string::npos)       return "level-up";
+    return "other";
+}
+
+std::string Summary(const BuildFileDiff& diff) {
+    std::string name(GitStatus::FileName(diff.file));
+    if (diff.added)   return name + ": new build";
+    if (diff.removed) return name + ": deleted";
+    if (!diff.error.empty()) return name + ": changed (" + diff.error + ")";
+    if (diff.changes.empty()) return name + ": formatting only";
+
+    const char* order[] = {"feat", "enhancement", "gear", "level-up", "other"};
+    std::map<std::string, int> counts;
+    for (const auto& c : diff.changes) counts[Category(c.path)]++;
+    std::string parts;
+    for (const char* cat : order) {
+        auto it = counts.find(cat);
+        if (it == counts.end()) continue;
+        if (!parts.empty()) parts += ", ";
+        parts += std::to_string(it->second) + " " + cat;
+    }
+    return name + ": " + parts + " change(s)";
+}
+
+std::string Describe(const BuildChange& change) {
+    switch (change.kind) {
+    case BuildChange::Kind::Added:
+        return "  + " + change.path + (change.newValue.empty() ? "" : ": " + Shorten(change.newValue));
+    case BuildChange::Kind::Removed:
+        return "  - " + change.path + (change.oldValue.empty() ? "" : ": " + Shorten(change.oldValue));
+    default:
+        return "  ~ " + change.path + ": " + Shorten(change.oldValue) + " -> " + Shorten(change.newValue);
+    }
+}
+
+bool DiffRevisions(GitManager& git, const std::string& from, const std::string& to,
+                   std::vector<BuildFileDiff>& out) {
+    Trace::Span span("diff.revisions", "sync");
+    out.clear();
+
+    // ":<mode> <mode> <old id> <new id> <status>\0<path>\0" per changed file
+    std::string raw;
+    if (git.RunGitQuiet("diff --raw -z --no-abbrev --no-renames " + from + " " + to +
+                        " -- \"*.DDOBuild\"", raw) != 0) {
+        git.LogOutput(raw);
+        return false;
+    }
+
+    struct Pending {
+        std::string oldId, newId;
+    };
+    std::vector<Pending> pending;
+    size_t pos = 0;
+    while (pos < raw.size() && raw[pos] == ':') {
+        size_t headerEnd = raw.find('\0', pos);
+        if (headerEnd == std::string::npos) break;
+        size_t pathEnd = raw.find('\0', headerEnd + 1);
+        if (pathEnd == std::string::npos) break;
+
+        std::istringstream header(raw.substr(pos + 1, headerEnd - pos - 1));
+        std::string oldMode, newMode, oldId, newId, status;
+        header >> oldMode >> newMode >> oldId >> newId >> status;
+
+        BuildFileDiff diff;
+        diff.file = raw.substr(headerEnd + 1, pathEnd - headerEnd - 1);
+        diff.added = oldId == kZeroId;
+        diff.removed = newId == kZeroId;
+        out.push_back(std::move(diff));
+        pending.push_back({oldId, newId});
+        pos = pathEnd + 1;
+    }
+    if (out.empty()) return true;
+
+    // Both sides of every modified file in one batch
+    std::string ids;
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (out[i].added || out[i].removed) continue;
+        ids += pending[i].oldId + "\n" + pending[i].newId + "\n";
+    }
+    if (ids.empty()) return true;
+
+    std::string batch;
+    if (git.RunGitQuiet("cat-file --batch", batch, [&ids](const ProcessWriteFn& write) {
+            write(ids.data(), ids.size());
+        }) != 0) {
+        git.LogOutput("Reading build versions failed");
+        return false;
+    }
+
+    // "<id> blob <size>\n<content>\n" per id, in request order
+    std::map<std::string, std::string> blobs;
+    pos = 0;
+    while (pos < batch.size()) {
+        size_t lineEnd = batch.find('\n', pos);
+        if (lineEnd == std::string::npos) break;
+        std::istringstream header(batch.substr(pos, lineEnd - pos));
+        std::string id, type;
+        size_t size = 0;
+        header >> id >> type >> size;
+        pos = lineEnd + 1;
+        if (type != "blob" || pos + size > batch.size()) continue;
+        blobs[id] = batch.substr(pos, size);
+        pos += size + 1;
+    }
+
+    for (size_t i = 0; i < out.size(); ++i) {
+        BuildFileDiff& diff = out[i];
+        if (diff.added || diff.removed) continue;
+        auto a = blobs.find(pending[i].oldId);
+        auto b = blobs.find(pending[i].newId);
+        if (a == blobs.end() || b == blobs.end()) {
+            diff.error = "contents not available";
+            continue;
+        }
+        Compare(a->second, b->second, diff.changes, diff.error);
+    }
+    return true;
+}
+
+} // namespace BuildDiff
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+
+class GitManager;
+
+// One difference between two versions of a build. path names the element
+// below the root, with repeated elements told apart by an identifying child
+// or attribute: "Character/LevelTraining[Level=5]/FeatTrained". A changed
+// attribute is reported as "<element path>/@<attribute>".
+struct BuildChange {
+    enum class Kind { Added, Removed, Changed };
+    Kind kind = Kind::Changed;
+    std::string path;
+    std::string oldValue;   // element text for leaves, "" for sections
+    std::string newValue;
+};
+
+struct BuildFileDiff {
+    std::string file;       // repo-relative path
+    bool added = false;     // new file: changes left empty
+    bool removed = false;   // deleted file: changes left empty
+    std::vector<BuildChange> changes;
+    std::string error;      // one side wasn't well-formed XML
+};
+
+// Structural diff of .DDOBuild files. Each side is streamed once through
+// XmlReader into a tree holding only element names, keys, leaf text and a
+// hash of every subtree; comparing walks both trees and skips any subtree
+// whose hashes match, so unchanged sections cost one comparison each.
+namespace BuildDiff {
+
+// Differences between two versions of one build, in document order.
+// False with error set if either side is not well-formed.
+bool Compare(const std::string& oldXml, const std::string& newXml,
+             std::vector<BuildChange>& out, std::string& error);
+
+// "feat", "enhancement", "gear", "level-up" or "other", from the path
+const char* Category(const std::string& path);
+
+// "Bob.DDOBuild: 2 feat, 1 level-up change(s)"
+std::string Summary(const BuildFileDiff& diff);
+
+// "  ~ Character/Race: Human -> Elf"
+std::string Describe(const BuildChange& change);
+
+// Every .DDOBuild that differs between two revisions. Two git spawns in
+// all: `diff --raw` for the blob ids, one `cat-file --batch` for contents.
+bool DiffRevisions(GitManager& git, const std::string& from, const std::string& to,
+                   std::vector<BuildFileDiff>& out);
+
+} // namespace BuildDiff
@@ -0,0 +1,227 @@
+#include "bundle_sync.h"
+#include "trace.h"
+#include "utils.h"
+#include <nlohmann/json.hpp>
+#include <cctype>
+#include <fstream>
+#include <vector>
+
+using json = nlohmann::json;
+
+static std::string Trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+static bool IsCommitId(const std::string& s) {
+    if (s.size() != 40 && s.size() != 64) return false;
+    for (char c : s) {
+        if (!isxdigit(static_cast<unsigned char>(c))) return false;
+    }
+    return true;
+}
+
+// Write next to the target, then swap it in, so a peer reading the shared
+// folder mid-sync sees either the old file or the new one
+static bool ReplaceFile(const std::string& tmp, const std::string& path) {
+    return MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+std::string BundleSync::DefaultPeerName() {
+    char buf[MAX_COMPUTERNAME_LENGTH + 1];
+    DWORD size = sizeof(buf);
+    std::string name = GetComputerNameA(buf, &size) ? std::string(buf, size) : "peer";
+    for (char& c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') c = '_';
+    }
+    return name;
+}
+
+std::string BundleSync::PathFor(const std::string& peer, const char* ext) const {
+    return m_dir + "\\" + peer + ext;
+}
+
+std::string BundleSync::ResolveCommit(const std::string& rev) {
+    if (rev.empty()) return "";
+    std::string output;
+    if (m_git.RunGit("rev-parse -q --verify \"" + rev + "^{commit}\"", output) != 0) return "";
+    output = Trim(output);
+    return IsCommitId(output) ? output : "";
+}
+
+bool BundleSync::LoadState(const std::string& path, PeerState& state) {
+    std::ifstream f(path);
+    if (!f.is_open()) return false;
+
+    try {
+        json j = json::parse(f);
+        if (j.contains("head")) state.head = j["head"].get<std::string>();
+        if (j.contains("base")) state.base = j["base"].get<std::string>();
+        if (j.contains("imported"))
+            state.imported = j["imported"].get<std::map<std::string, std::string>>();
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool BundleSync::SaveState(const PeerState& state) const {
+    json j;
+    j["head"]     = state.head;
+    j["base"]     = state.base;
+    j["imported"] = state.imported;
+    j["updated"]  = Utils::GetTimestamp();
+
+    std::string path = PathFor(m_peer, ".json");
+    {
+        std::ofstream f(path + ".tmp");
+        if (!f.is_open()) return false;
+        f << j.dump(2);
+        if (!f.good()) return false;
+    }
+    return ReplaceFile(path + ".tmp", path);
+}
+
+bool BundleSync::Sync() {
+    if (m_dir.empty()) return false;
+    if (m_peer.empty()) m_peer = DefaultPeerName();
+    Trace::Span span("bundle.sync", "sync");
+
+    CreateDirectoryA(m_dir.c_str(), nullptr);
+    if (!Utils::DirExists(m_dir)) {
+        m_git.LogOutput("Bundle folder not reachable: " + m_dir);
+        return false;
+    }
+
+    // Every peer that has synced through this folder left a <peer>.json
+    PeerState self;
+    std::map<std::string, PeerState> peers;
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA((m_dir + "\\*.json").c_str(), &fd);
+    if (h != INVALID_HANDLE_VALUE) {
+        do {
+            std::string name = fd.cFileName;
+            name = name.substr(0, name.size() - 5);
+            PeerState state;
+            // A peer caught mid-write counts as having no watermark this time
+            LoadState(m_dir + "\\" + fd.cFileName, state);
+            if (name == m_peer) self = state;
+            else peers[name] = state;
+        } while (FindNextFileA(h, &fd));
+        FindClose(h);
+    }
+
+    bool ok = true;
+    for (const auto& p : peers) {
+        if (!Import(p.first, self)) ok = false;
+    }
+
+    if (!Export(peers, self)) ok = false;
+
+    self.head = ResolveCommit("main");
+    if (!SaveState(self)) {
+        m_git.LogOutput("Failed to write bundle state for " + m_peer);
+        ok = false;
+    }
+    return ok;
+}
+
+bool BundleSync::Import(const std::string& peer, PeerState& self) {
+    std::string file = PathFor(peer, ".bundle");
+    if (!Utils::FileExists(file)) return true;
+
+    std::string output;
+    if (m_git.RunGit("bundle list-heads \"" + file + "\" refs/heads/main", output) != 0) {
+        m_git.LogOutput("Unreadable bundle from " + peer);
+        return false;
+    }
+    std::string tip = Trim(output.substr(0, output.find(' ')));
+    if (!IsCommitId(tip)) return true;
+
+    // Already merged (directly or through origin / another peer)
+    if (self.imported[peer] == tip) return true;
+    if (!ResolveCommit(tip).empty() && m_git.RunGit("merge-base --is-ancestor " + tip + " main", output) == 0) {
+        self.imported[peer] = tip;
+        return true;
+    }
+
+    Trace::Span span("bundle.import", "sync", peer);
+    std::string ref = "refs/ddobuildsync/bundles/" + peer;
+    if (m_git.RunGit("fetch -q --no-tags \"" + file + "\" +refs/heads/main:" + ref, output) != 0) {
+        // The bundle starts at a commit we never got: wait for origin, or
+        // for the peer to see our watermark and write a bundle we can use
+        m_git.LogOutput("Bundle from " + peer + " builds on commits this machine doesn't have yet");
+        return false;
+    }
+
+    // No common history: one side is on main from before a history
+    // compaction. Merging can't fix that; the old side has to pull once.
+    if (m_git.RunGitQuiet("merge-base main " + ref, output) == 1) {
+        m_git.LogOutput("Bundle from " + peer + " shares no history with main (compacted on one side); "
+                        "pull from origin on the machine with the older history");
+        return false;
+    }
+
+    if (m_git.RunGit("merge --no-edit --autostash -m \"Merge builds from " + peer + "\" " + ref, output) != 0) {
+        m_git.RunGit("merge --abort", output);
+        m_git.LogOutput("Merging builds from " + peer + " failed - resolve manually");
+        return false;
+    }
+
+    m_git.LogOutput("Imported builds from " + peer);
+    self.imported[peer] = tip;
+    return true;
+}
+
+bool BundleSync::Export(const std::map<std::string, PeerState>& peers, PeerState& self) {
+    std::string head = ResolveCommit("main");
+    if (head.empty()) return false;
+
+    std::string file = PathFor(m_peer, ".bundle");
+
+    // Newest commit each peer is known to have: its own head if we have
+    // that commit, else the tip of ours it last imported
+    std::vector<std::string> watermarks;
+    bool full = peers.empty();
+    for (const auto& p : peers) {
+        std::string w = ResolveCommit(p.second.head);
+        if (w.empty()) {
+            auto it = p.second.imported.find(m_peer);
+            if (it != p.second.imported.end()) w = ResolveCommit(it->second);
+        }
+        if (w.empty()) {
+            full = true;
+            break;
+        }
+        watermarks.push_back(w);
+    }
+
+    std::string output;
+    std::string base;
+    if (!full) {
+        std::string args = "merge-base --octopus";
+        for (const auto& w : watermarks) args += " " + w;
+        if (m_git.RunGit(args, output) == 0) base = Trim(output);
+        if (base == head) return true;      // every peer is up to date
+    }
+
+    // Same commits as the bundle already in the folder
+    if (self.head == head && self.base == base && Utils::FileExists(file)) return true;
+
+    std::string range = base.empty() ? "main" : base + "..main";
+    Trace::Span span("bundle.export", "sync", base.empty() ? "full" : "incremental");
+    if (m_git.RunGit("bundle create -q \"" + file + ".tmp\" " + range, output) != 0) {
+        m_git.LogOutput("Failed to write bundle");
+        DeleteFileA((file + ".tmp").c_str());
+        return false;
+    }
+    if (!ReplaceFile(file + ".tmp", file)) {
+        m_git.LogOutput("Failed to replace " + file + " (in use by another machine?)");
+        DeleteFileA((file + ".tmp").c_str());
+        return false;
+    }
+    self.base = base;
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "git_manager.h"
+#include <map>
+#include <string>
+
+// Sync through a shared folder (LAN drive, USB stick) instead of a network
+// remote. Each machine ("peer") owns two files in the folder:
+//
+//   <peer>.bundle   main's commits that some other peer doesn't have yet
+//   <peer>.json     {"head": <main after the last sync>,
+//                    "base": <commit the bundle starts after, "" = full>,
+//                    "imported": {<other peer>: <bundle tip merged>}}
+//
+// The json files are the watermarks: a peer's bundle starts at the newest
+// commit every other peer is known to have, so it only carries new commits.
+// Importing a peer's bundle is one fetch into refs/ddobuildsync/bundles/<peer>
+// followed by a merge (never a rebase: bundled commits are already shared).
+class BundleSync {
+public:
+    explicit BundleSync(GitManager& git) : m_git(git) {}
+
+    void SetDirectory(const std::string& dir) { m_dir = dir; }
+    void SetPeerName(const std::string& name) { m_peer = name; }
+
+    // Computer name, reduced to characters safe in file and ref names
+    static std::string DefaultPeerName();
+
+    // Import every peer's new bundle, then write ours. Returns false if
+    // anything failed; peers that did import stay imported.
+    bool Sync();
+
+private:
+    struct PeerState {
+        std::string head;
+        std::string base;
+        std::map<std::string, std::string> imported;
+    };
+
+    GitManager& m_git;
+    std::string m_dir;
+    std::string m_peer;
+
+    bool Import(const std::string& peer, PeerState& self);
+    bool Export(const std::map<std::string, PeerState>& peers, PeerState& self);
+
+    // Full commit id of rev, or "" if this repo doesn't have it
+    std::string ResolveCommit(const std::string& rev);
+
+    std::string PathFor(const std::string& peer, const char* ext) const;
+    static bool LoadState(const std::string& path, PeerState& state);
+    bool SaveState(const PeerState& state) const;
+};
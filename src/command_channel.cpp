@@ -0,0 +1,143 @@
+#include "command_channel.h"
+#include <vector>
+
+// Commands and replies are short; anything longer is cut off
+static const DWORD kMaxMessage = 64 * 1024;
+
+// A client that connects and then stalls mustn't hold up the next one
+static const DWORD kClientTimeoutMs = 2000;
+
+static const char* kInstanceMutex = "Local\\DDOBuildSync_instance";
+
+// Pipes aren't per session like Local\ objects, so the session goes in the name
+static std::string PipeName() {
+    DWORD session = 0;
+    ProcessIdToSessionId(GetCurrentProcessId(), &session);
+    return "\\\\.\\pipe\\DDOBuildSync_" + std::to_string(session);
+}
+
+namespace CommandChannel {
+
+bool ClaimInstance() {
+    HANDLE instance = CreateMutexA(nullptr, FALSE, kInstanceMutex);
+    if (!instance) return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        // Holding it would keep the mutex alive after the owner exits
+        CloseHandle(instance);
+        return false;
+    }
+    return true;    // never closed: goes away with the process
+}
+
+bool InstanceRunning() {
+    HANDLE instance = OpenMutexA(SYNCHRONIZE, FALSE, kInstanceMutex);
+    if (!instance) return false;
+    CloseHandle(instance);
+    return true;
+}
+
+bool Send(const std::string& command, std::string& reply, DWORD timeoutMs) {
+    std::vector<char> buffer(kMaxMessage);
+    DWORD read = 0;
+    // Connect (waiting while another client is being served), write, read, close
+    if (!CallNamedPipeA(PipeName().c_str(), const_cast<char*>(command.data()),
+                        static_cast<DWORD>(command.size()), buffer.data(), kMaxMessage,
+                        &read, timeoutMs) &&
+        GetLastError() != ERROR_MORE_DATA) {
+        return false;
+    }
+    reply.assign(buffer.data(), read);
+    return true;
+}
+
+} // namespace CommandChannel
+
+// ---------- CommandServer ----------
+
+bool CommandServer::Start(Handler handler) {
+    Stop();
+    m_handler = std::move(handler);
+
+    // One pipe instance, so commands run one at a time in arrival order.
+    // FIRST_PIPE_INSTANCE fails if anything else already serves the name.
+    m_pipe = CreateNamedPipeA(PipeName().c_str(),
+                              PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                              PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                              1, kMaxMessage, kMaxMessage, 0, nullptr);
+    if (m_pipe == INVALID_HANDLE_VALUE) return false;
+
+    m_stopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    m_thread = std::thread(&CommandServer::Run, this);
+    return true;
+}
+
+void CommandServer::Stop() {
+    if (m_thread.joinable()) {
+        SetEvent(m_stopEvent);
+        m_thread.join();
+    }
+    if (m_stopEvent) CloseHandle(m_stopEvent);
+    m_stopEvent = nullptr;
+    if (m_pipe != INVALID_HANDLE_VALUE) CloseHandle(m_pipe);
+    m_pipe = INVALID_HANDLE_VALUE;
+}
+
+// Wait for an overlapped pipe call started with `started` as its result.
+// 1: completed, 0: failed or timed out (cancelled), -1: Stop() was called.
+static int Complete(HANDLE pipe, BOOL started, OVERLAPPED& ov, HANDLE stopEvent,
+                    DWORD timeoutMs, DWORD& bytes) {
+    bytes = 0;
+    if (!started) {
+        DWORD err = GetLastError();
+        if (err == ERROR_PIPE_CONNECTED) return 1;
+        if (err != ERROR_IO_PENDING) return 0;
+    }
+
+    HANDLE waits[2] = {ov.hEvent, stopEvent};
+    DWORD w = WaitForMultipleObjects(2, waits, FALSE, timeoutMs);
+    if (w != WAIT_OBJECT_0) {
+        CancelIoEx(pipe, &ov);
+        GetOverlappedResult(pipe, &ov, &bytes, TRUE);
+        return w == WAIT_OBJECT_0 + 1 ? -1 : 0;
+    }
+    return GetOverlappedResult(pipe, &ov, &bytes, FALSE) ? 1 : 0;
+}
+
+void CommandServer::Run() {
+    std::vector<char> buffer(kMaxMessage);
+    OVERLAPPED ov = {};
+    ov.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    DWORD bytes = 0;
+
+    for (;;) {
+        ResetEvent(ov.hEvent);
+        int rc = Complete(m_pipe, ConnectNamedPipe(m_pipe, &ov), ov, m_stopEvent, INFINITE, bytes);
+        if (rc < 0) break;
+
+        if (rc > 0) {
+            ResetEvent(ov.hEvent);
+            rc = Complete(m_pipe, ReadFile(m_pipe, buffer.data(), kMaxMessage, nullptr, &ov),
+                          ov, m_stopEvent, kClientTimeoutMs, bytes);
+        }
+        if (rc > 0) {
+            std::string reply = m_handler(std::string(buffer.data(), bytes));
+            if (reply.size() > kMaxMessage) reply.resize(kMaxMessage);
+
+            ResetEvent(ov.hEvent);
+            rc = Complete(m_pipe, WriteFile(m_pipe, reply.data(), static_cast<DWORD>(reply.size()), nullptr, &ov),
+                          ov, m_stopEvent, kClientTimeoutMs, bytes);
+
+            // Disconnecting drops a reply the client hasn't read yet; wait
+            // for it to hang up (the read fails) instead
+            if (rc > 0) {
+                ResetEvent(ov.hEvent);
+                rc = Complete(m_pipe, ReadFile(m_pipe, buffer.data(), kMaxMessage, nullptr, &ov),
+                              ov, m_stopEvent, kClientTimeoutMs, bytes);
+            }
+        }
+
+        DisconnectNamedPipe(m_pipe);
+        if (rc < 0) break;
+    }
+    CloseHandle(ov.hEvent);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <functional>
+#include <string>
+#include <thread>
+
+// One DDOBuildSync per logon session owns the builds repo. Later launches
+// (shortcuts, `DDOBuildSync.exe push`) and the CLI hand their command to it
+// over a local named pipe instead of starting cold and racing it on git.
+//
+// Protocol: one message each way. The client writes a command line
+// ("push", "status"); the server answers with a JSON object that always
+// has "ok" and, when ok is false, "error".
+namespace CommandChannel {
+
+// Take the single-instance mutex for the life of the process. False if
+// another instance already has it.
+bool ClaimInstance();
+
+// True if an instance (not necessarily this process) holds the mutex
+bool InstanceRunning();
+
+// Send one command and wait for the reply. False if no instance answered
+// within timeoutMs (none running, or it is shutting down).
+bool Send(const std::string& command, std::string& reply, DWORD timeoutMs = 5000);
+
+} // namespace CommandChannel
+
+class CommandServer {
+public:
+    // Called on the server thread, one command at a time; returns the reply
+    using Handler = std::function<std::string(const std::string& command)>;
+
+    ~CommandServer() { Stop(); }
+
+    bool Start(Handler handler);
+    void Stop();
+
+private:
+    Handler m_handler;
+    HANDLE m_pipe = INVALID_HANDLE_VALUE;
+    HANDLE m_stopEvent = nullptr;
+    std::thread m_thread;
+
+    void Run();
+};
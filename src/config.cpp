@@ -1,21 +1,16 @@
 #include "config.h"
+#include "utils.h"
 #include <nlohmann/json.hpp>
+#include <chrono>
 #include <fstream>
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
 
 using json = nlohmann::json;
 
-static std::string GetExeDir() {
-    char buf[MAX_PATH];
-    GetModuleFileNameA(nullptr, buf, MAX_PATH);
-    std::string path(buf);
-    auto pos = path.find_last_of("\\/");
-    return (pos != std::string::npos) ? path.substr(0, pos) : ".";
-}
+// Commits within this long of each other are saved as one write
+static const int kConfigSaveDelayMs = 2000;
 
 std::string ConfigManager::GetConfigPath() {
-    return GetExeDir() + "\\ddobuildsync_config.json";
+    return Utils::GetExeDir() + "\\ddobuildsync_config.json";
 }
 
 bool ConfigManager::Load(const std::string& path) {
@@ -26,27 +21,112 @@ bool ConfigManager::Load(const std::string& path) {
         json j = json::parse(f);
         if (j.contains("buildsFolder"))    m_config.buildsFolder    = j["buildsFolder"].get<std::string>();
         if (j.contains("ddoBuilderExe"))   m_config.ddoBuilderExe   = j["ddoBuilderExe"].get<std::string>();
+        if (j.contains("installSearchRoots"))
+            m_config.installSearchRoots = j["installSearchRoots"].get<std::vector<std::string>>();
         if (j.contains("gitRepoUrl"))      m_config.gitRepoUrl      = j["gitRepoUrl"].get<std::string>();
+        if (j.contains("mirrorUrls"))      m_config.mirrorUrls      = j["mirrorUrls"].get<std::vector<std::string>>();
+        if (j.contains("remoteTimeoutSec"))m_config.remoteTimeoutSec= j["remoteTimeoutSec"].get<int>();
         if (j.contains("autoPushOnClose")) m_config.autoPushOnClose = j["autoPushOnClose"].get<bool>();
         if (j.contains("autoPullOnLaunch"))m_config.autoPullOnLaunch= j["autoPullOnLaunch"].get<bool>();
+        if (j.contains("syncMinIntervalMin"))  m_config.syncMinIntervalMin  = j["syncMinIntervalMin"].get<int>();
+        if (j.contains("syncMaxStalenessMin")) m_config.syncMaxStalenessMin = j["syncMaxStalenessMin"].get<int>();
+        if (j.contains("traceEnabled"))    m_config.traceEnabled    = j["traceEnabled"].get<bool>();
+        if (j.contains("gitTrace2Enabled"))m_config.gitTrace2Enabled= j["gitTrace2Enabled"].get<bool>();
+        if (j.contains("canonicalizeBuilds")) m_config.canonicalizeBuilds = j["canonicalizeBuilds"].get<bool>();
+        if (j.contains("canonicalUnorderedElements"))
+            m_config.canonicalUnorderedElements = j["canonicalUnorderedElements"].get<std::vector<std::string>>();
+        if (j.contains("fsmonitorEnabled")) m_config.fsmonitorEnabled = j["fsmonitorEnabled"].get<bool>();
+        if (j.contains("mergeBuilds"))    m_config.mergeBuilds    = j["mergeBuilds"].get<bool>();
+        if (j.contains("bundleDir"))      m_config.bundleDir      = j["bundleDir"].get<std::string>();
+        if (j.contains("bundlePeerName")) m_config.bundlePeerName = j["bundlePeerName"].get<std::string>();
+        if (j.contains("compactHistory"))   m_config.compactHistory   = j["compactHistory"].get<bool>();
+        if (j.contains("compactAfterDays")) m_config.compactAfterDays = j["compactAfterDays"].get<int>();
+        if (j.contains("compactPeriod"))    m_config.compactPeriod    = j["compactPeriod"].get<std::string>();
+        if (j.contains("maxSyncWorkers")) m_config.maxSyncWorkers = j["maxSyncWorkers"].get<int>();
+        if (j.contains("profiles")) {
+            m_config.profiles.clear();
+            for (const auto& p : j["profiles"]) {
+                SyncProfile profile;
+                profile.name            = p.value("name", "");
+                profile.buildsFolder    = p.value("buildsFolder", "");
+                profile.gitRepoUrl      = p.value("gitRepoUrl", "");
+                profile.syncIntervalMin = p.value("syncIntervalMin", 60);
+                if (p.contains("mirrorUrls")) profile.mirrorUrls = p["mirrorUrls"].get<std::vector<std::string>>();
+                m_config.profiles.push_back(profile);
+            }
+        }
+        if (j.contains("syncFolders"))    m_config.syncFolders    = j["syncFolders"].get<std::vector<std::string>>();
+        if (j.contains("syncCharacters")) m_config.syncCharacters = j["syncCharacters"].get<std::vector<std::string>>();
+        if (j.contains("syncBackups"))    m_config.syncBackups    = j["syncBackups"].get<bool>();
+        if (j.contains("syncExclude"))    m_config.syncExclude    = j["syncExclude"].get<std::vector<std::string>>();
+        Publish();
         return true;
     } catch (...) {
         return false;
     }
 }
 
-bool ConfigManager::Save(const std::string& path) const {
+static std::string ToJsonText(const SyncConfig& cfg) {
     json j;
-    j["buildsFolder"]     = m_config.buildsFolder;
-    j["ddoBuilderExe"]    = m_config.ddoBuilderExe;
-    j["gitRepoUrl"]       = m_config.gitRepoUrl;
-    j["autoPushOnClose"]  = m_config.autoPushOnClose;
-    j["autoPullOnLaunch"] = m_config.autoPullOnLaunch;
+    j["buildsFolder"]     = cfg.buildsFolder;
+    j["ddoBuilderExe"]    = cfg.ddoBuilderExe;
+    j["installSearchRoots"] = cfg.installSearchRoots;
+    j["gitRepoUrl"]       = cfg.gitRepoUrl;
+    j["mirrorUrls"]       = cfg.mirrorUrls;
+    j["remoteTimeoutSec"] = cfg.remoteTimeoutSec;
+    j["autoPushOnClose"]  = cfg.autoPushOnClose;
+    j["autoPullOnLaunch"] = cfg.autoPullOnLaunch;
+    j["syncMinIntervalMin"]  = cfg.syncMinIntervalMin;
+    j["syncMaxStalenessMin"] = cfg.syncMaxStalenessMin;
+    j["traceEnabled"]     = cfg.traceEnabled;
+    j["gitTrace2Enabled"] = cfg.gitTrace2Enabled;
+    j["canonicalizeBuilds"] = cfg.canonicalizeBuilds;
+    j["canonicalUnorderedElements"] = cfg.canonicalUnorderedElements;
+    j["fsmonitorEnabled"] = cfg.fsmonitorEnabled;
+    j["mergeBuilds"]      = cfg.mergeBuilds;
+    j["bundleDir"]        = cfg.bundleDir;
+    j["bundlePeerName"]   = cfg.bundlePeerName;
+    j["compactHistory"]   = cfg.compactHistory;
+    j["compactAfterDays"] = cfg.compactAfterDays;
+    j["compactPeriod"]    = cfg.compactPeriod;
+    j["maxSyncWorkers"]   = cfg.maxSyncWorkers;
+    j["profiles"]         = json::array();
+    for (const auto& profile : cfg.profiles) {
+        json p;
+        p["name"]            = profile.name;
+        p["buildsFolder"]    = profile.buildsFolder;
+        p["gitRepoUrl"]      = profile.gitRepoUrl;
+        p["mirrorUrls"]      = profile.mirrorUrls;
+        p["syncIntervalMin"] = profile.syncIntervalMin;
+        j["profiles"].push_back(p);
+    }
+    j["syncFolders"]      = cfg.syncFolders;
+    j["syncCharacters"]   = cfg.syncCharacters;
+    j["syncBackups"]      = cfg.syncBackups;
+    j["syncExclude"]      = cfg.syncExclude;
 
-    std::ofstream f(path);
-    if (!f.is_open()) return false;
-    f << j.dump(2);
-    return f.good();
+    return j.dump(2);
+}
+
+// Write to a temp file next to path, flush it to disk, then rename over
+// path: a crash leaves either the old config or the new one, never half
+static bool WriteFileAtomic(const std::string& path, const std::string& content) {
+    std::string tmp = path + ".tmp";
+    HANDLE h = CreateFileA(tmp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+
+    DWORD written = 0;
+    bool ok = WriteFile(h, content.data(), static_cast<DWORD>(content.size()), &written, nullptr) &&
+              written == content.size() && FlushFileBuffers(h);
+    CloseHandle(h);
+    if (ok) ok = MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+    if (!ok) DeleteFileA(tmp.c_str());
+    return ok;
+}
+
+bool ConfigManager::Save(const std::string& path) const {
+    return WriteFileAtomic(path, ToJsonText(m_config));
 }
 
 bool ConfigManager::LoadDefault() {
@@ -54,10 +134,86 @@ bool ConfigManager::LoadDefault() {
     if (Load(userConfig)) return true;
 
     // Fall back to default_config.json
-    std::string defaultConfig = GetExeDir() + "\\default_config.json";
+    std::string defaultConfig = Utils::GetExeDir() + "\\default_config.json";
     return Load(defaultConfig);
 }
 
 bool ConfigManager::SaveDefault() const {
     return Save(GetConfigPath());
 }
+
+ConfigManager::~ConfigManager() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_writer.joinable()) m_writer.join();
+    Flush();
+}
+
+void ConfigManager::Publish() {
+    auto snapshot = std::make_shared<const SyncConfig>(m_config);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_snapshot = std::move(snapshot);
+}
+
+std::shared_ptr<const SyncConfig> ConfigManager::Snapshot() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_snapshot;
+}
+
+void ConfigManager::Commit() {
+    auto snapshot = std::make_shared<const SyncConfig>(m_config);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_snapshot = std::move(snapshot);
+        m_dirty = true;
+        if (!m_writer.joinable() && !m_stopping) m_writer = std::thread(&ConfigManager::WriterLoop, this);
+    }
+    m_cv.notify_all();
+}
+
+bool ConfigManager::Flush() {
+    // Flush can run on the writer thread and at shutdown at the same time;
+    // picking the snapshot under the write lock keeps an older one from
+    // being written after a newer one
+    std::lock_guard<std::mutex> writeLock(m_writeMutex);
+    std::shared_ptr<const SyncConfig> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_dirty) return true;
+        m_dirty = false;
+        snapshot = m_snapshot;
+    }
+    if (WriteSnapshot(*snapshot)) return true;
+
+    // Still owed: the writer (or the shutdown flush) tries again
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dirty = true;
+    return false;
+}
+
+void ConfigManager::WriterLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_cv.wait(lock, [this]() { return m_dirty || m_stopping; });
+        if (m_stopping) break;
+
+        // Let a burst of commits settle; the destructor flushes what's left
+        m_cv.wait_for(lock, std::chrono::milliseconds(kConfigSaveDelayMs), [this]() { return m_stopping; });
+        if (m_stopping) break;
+
+        lock.unlock();
+        Flush();
+        lock.lock();
+    }
+}
+
+bool ConfigManager::WriteSnapshot(const SyncConfig& cfg) {
+    std::string content = ToJsonText(cfg);
+    if (content == m_lastWritten) return true;
+    if (!WriteFileAtomic(GetConfigPath(), content)) return false;
+    m_lastWritten = std::move(content);
+    return true;
+}
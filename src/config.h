@@ -1,20 +1,69 @@
 #pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+
+// An extra builds folder synced with its own repo (e.g. a preview-server
+// install of DDO Builder), in the background beside the main folder
+struct SyncProfile {
+    std::string name;
+    std::string buildsFolder;
+    std::string gitRepoUrl;
+    std::vector<std::string> mirrorUrls;
+    int syncIntervalMin = 60;
+};
 
 struct SyncConfig {
     std::string buildsFolder;
     std::string ddoBuilderExe;
+    std::vector<std::string> installSearchRoots;    // searched for DDO Builder besides Documents, Desktop, Program Files
     std::string gitRepoUrl;
+    std::vector<std::string> mirrorUrls;    // pushed alongside gitRepoUrl; pulls use the fastest
+    int remoteTimeoutSec = 120;             // per remote fetch/push; 0 = no limit
     bool autoPushOnClose = true;
     bool autoPullOnLaunch = true;
+    int syncMinIntervalMin = 10;    // background sync interval while builds are changing
+    int syncMaxStalenessMin = 240;  // ...backing off to at most this when nothing changes
+    bool traceEnabled = false;      // write sync timing spans to ddobuildsync_trace.json
+    bool gitTrace2Enabled = true;   // attribute git child time via GIT_TRACE2_EVENT
+    bool canonicalizeBuilds = true; // store .DDOBuild files in canonical form (git clean filter)
+    std::vector<std::string> canonicalUnorderedElements;  // children sorted when canonicalizing
+    bool fsmonitorEnabled = true;   // answer git's fsmonitor hook from the app's folder watcher
+    bool mergeBuilds = true;        // merge concurrent .DDOBuild edits per element (git merge driver)
+    std::string bundleDir;          // shared folder for bundle sync (see BundleSync); empty = off
+    std::string bundlePeerName;     // this machine's name in bundleDir; empty = computer name
+    bool compactHistory = false;    // squash old auto-commits (see HistoryCompactor); rewrites main
+    int compactAfterDays = 90;      // ...that are older than this
+    std::string compactPeriod = "week";     // one commit per "day" or "week"
+
+    // Extra folders synced on a shared worker pool of maxSyncWorkers threads
+    std::vector<SyncProfile> profiles;
+    int maxSyncWorkers = 3;
+
+    // Sync rules (see SyncRules). Folders are relative to buildsFolder and
+    // may end in "/**" for all subfolders; empty = buildsFolder only.
+    std::vector<std::string> syncFolders;
+    std::vector<std::string> syncCharacters;    // only builds named after these; empty = all
+    bool syncBackups = true;                    // also sync *.DDOBuild.backup
+    std::vector<std::string> syncExclude;       // patterns never synced
 };
 
+// Owns the config. The UI thread edits Get() and calls Commit(); other
+// threads read Snapshot(), an immutable copy published by Load/Commit.
+// Commit() saves write-behind: edits within kConfigSaveDelayMs coalesce into
+// one write, and saves replace the file atomically (temp file, flush,
+// rename) and are skipped when the content is unchanged.
 class ConfigManager {
 public:
+    ~ConfigManager();
+
     // Load config from JSON file. Returns true on success.
     bool Load(const std::string& path);
 
-    // Save config to JSON file. Returns true on success.
+    // Save config to JSON file now, atomically. Returns true on success.
     bool Save(const std::string& path) const;
 
     // Load default_config.json from same directory as exe
@@ -23,12 +72,36 @@ public:
     // Save to the standard config path next to exe
     bool SaveDefault() const;
 
+    // Mutable config, UI thread only; call Commit() after changing it
     SyncConfig& Get() { return m_config; }
     const SyncConfig& Get() const { return m_config; }
 
+    // Latest committed config; safe to keep and read from any thread
+    std::shared_ptr<const SyncConfig> Snapshot() const;
+
+    // Publish Get() as the new snapshot and schedule a save to the standard path
+    void Commit();
+
+    // Write a pending Commit() now (shutdown). Returns false if the write
+    // failed; the commit then stays pending.
+    bool Flush();
+
     // Path to user config file (next to exe)
     static std::string GetConfigPath();
 
 private:
     SyncConfig m_config;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::shared_ptr<const SyncConfig> m_snapshot = std::make_shared<SyncConfig>();
+    bool m_dirty = false;
+    bool m_stopping = false;
+    std::thread m_writer;
+    std::mutex m_writeMutex;        // held by Flush from picking a snapshot to writing it
+    std::string m_lastWritten;      // file content of the last save, to skip no-op writes
+
+    void Publish();
+    void WriterLoop();
+    bool WriteSnapshot(const SyncConfig& cfg);
 };
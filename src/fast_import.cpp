@@ -0,0 +1,173 @@
+#include "fast_import.h"
+#include "utils.h"
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace FastImport {
+
+// Files read ahead of the stream writer, at most
+static const size_t kReadWindow = 64;
+
+static void ListDir(const std::string& dir, const std::string& relDir, const SyncRules& rules,
+                    std::vector<ImportFile>& files) {
+    std::wstring pattern = Utils::ToWide(dir + "\\*");
+    WIN32_FIND_DATAW fd;
+    HANDLE hFind = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &fd,
+                                    FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE) return;
+
+    do {
+        std::string name = Utils::ToUtf8(fd.cFileName);
+        std::string rel = relDir.empty() ? name : relDir + "/" + name;
+
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (name == "." || name == ".." || name == ".git") continue;
+            // Junctions could loop; git doesn't follow them either
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) continue;
+            if (rules.MatchDirectory(rel)) ListDir(dir + "\\" + name, rel, rules, files);
+            continue;
+        }
+        if (!rules.MatchFile(rel)) continue;
+
+        ImportFile f;
+        f.relPath  = rel;
+        f.fullPath = dir + "\\" + name;
+        f.size     = (static_cast<uint64_t>(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow;
+        files.push_back(std::move(f));
+    } while (FindNextFileW(hFind, &fd));
+    FindClose(hFind);
+}
+
+std::vector<ImportFile> ListFiles(const std::string& dir, const SyncRules& rules) {
+    std::vector<ImportFile> files;
+    ListDir(dir, "", rules, files);
+    std::sort(files.begin(), files.end(), [](const ImportFile& a, const ImportFile& b) {
+        return a.relPath < b.relPath;
+    });
+    return files;
+}
+
+static bool ReadWholeFile(const std::string& path, std::string& out) {
+    HANDLE h = CreateFileW(Utils::ToWide(path).c_str(), GENERIC_READ, FILE_SHARE_READ,
+                           nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    bool ok = GetFileSizeEx(h, &size) != 0;
+    if (ok) {
+        out.resize(static_cast<size_t>(size.QuadPart));
+        size_t done = 0;
+        while (done < out.size()) {
+            DWORD got = 0;
+            DWORD want = static_cast<DWORD>((std::min)(out.size() - done, static_cast<size_t>(1 << 20)));
+            if (!ReadFile(h, &out[done], want, &got, nullptr) || got == 0) break;
+            done += got;
+        }
+        // The file may have shrunk since it was sized
+        out.resize(done);
+    }
+    CloseHandle(h);
+    return ok;
+}
+
+// Per-file read result, filled by the pool and drained in order by the writer
+struct Slot {
+    std::string data;
+    bool ready = false;
+    bool failed = false;
+};
+
+bool WriteStream(const std::vector<ImportFile>& files, const ImportCommit& commit,
+                 const ProcessWriteFn& write, std::string& error,
+                 const ImportTransform& transform) {
+    std::vector<Slot> slots(files.size());
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<size_t> nextRead{0};
+    size_t drained = 0;       // guarded by mutex
+    bool aborted = false;     // guarded by mutex
+
+    unsigned threads = (std::max)(1u, (std::min)(std::thread::hardware_concurrency(), 8u));
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&]() {
+            for (;;) {
+                size_t i = nextRead++;
+                if (i >= files.size()) return;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&]() { return aborted || i < drained + kReadWindow; });
+                    if (aborted) return;
+                }
+                std::string data;
+                bool ok = ReadWholeFile(files[i].fullPath, data);
+                if (ok && transform) transform(files[i], data);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    slots[i].data = std::move(data);
+                    slots[i].failed = !ok;
+                    slots[i].ready = true;
+                }
+                cv.notify_all();
+            }
+        });
+    }
+
+    // Blobs first, one mark per file, then a single commit referencing them
+    bool ok = true;
+    for (size_t i = 0; i < files.size() && ok; ++i) {
+        std::string data;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return slots[i].ready; });
+            if (slots[i].failed) {
+                error = "Failed to read " + files[i].fullPath;
+                ok = false;
+                break;
+            }
+            data = std::move(slots[i].data);
+            drained = i + 1;
+        }
+        cv.notify_all();
+
+        std::string header = "blob\nmark :" + std::to_string(i + 1) +
+                             "\ndata " + std::to_string(data.size()) + "\n";
+        if (!write(header.data(), header.size()) ||
+            !write(data.data(), data.size()) ||
+            !write("\n", 1)) {
+            error = "git fast-import stopped reading its input";
+            ok = false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        aborted = true;
+    }
+    cv.notify_all();
+    for (auto& t : pool) t.join();
+    if (!ok) return false;
+
+    std::string tail = "commit " + commit.ref + "\n" +
+                       "committer " + commit.committerName + " <" + commit.committerEmail + "> now\n" +
+                       "data " + std::to_string(commit.message.size()) + "\n" +
+                       commit.message + "\n";
+    // Windows file names can't contain '"' or newlines, so paths need no quoting
+    for (size_t i = 0; i < files.size(); ++i) {
+        tail += "M 100644 :" + std::to_string(i + 1) + " " + files[i].relPath + "\n";
+    }
+    tail += "\ndone\n";
+
+    if (!write(tail.data(), tail.size())) {
+        error = "git fast-import stopped reading its input";
+        return false;
+    }
+    return true;
+}
+
+} // namespace FastImport
@@ -0,0 +1,40 @@
+#pragma once
+#include "process.h"
+#include "sync_rules.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+struct ImportFile {
+    std::string relPath;      // repo path, '/'-separated, UTF-8
+    std::string fullPath;     // on-disk path, UTF-8
+    uint64_t size = 0;
+};
+
+struct ImportCommit {
+    std::string ref = "refs/heads/main";
+    std::string committerName;
+    std::string committerEmail;
+    std::string message;
+};
+
+namespace FastImport {
+
+// Files below dir that the rules sync, sorted by path. Directories the
+// rules can't match are never opened, as with the generated .gitignore.
+std::vector<ImportFile> ListFiles(const std::string& dir, const SyncRules& rules);
+
+// Rewrites a file's content before it is stored (e.g. the clean filter
+// git would have applied on add). Runs on the reader threads.
+using ImportTransform = std::function<void(const ImportFile& file, std::string& data)>;
+
+// Write a `git fast-import --date-format=now` stream holding one commit with
+// all files. Files are read by a pool of threads a bounded window ahead of
+// the writer, so the stream stays in order while reads overlap.
+// Returns false if a file could not be read or the writer was refused.
+bool WriteStream(const std::vector<ImportFile>& files, const ImportCommit& commit,
+                 const ProcessWriteFn& write, std::string& error,
+                 const ImportTransform& transform = nullptr);
+
+} // namespace FastImport
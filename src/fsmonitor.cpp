@@ -0,0 +1,233 @@
+#include "fsmonitor.h"
+#include "utils.h"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <vector>
+
+// Start over (one full scan by git) rather than let the journal grow forever
+static const uint64_t kMaxJournalEntries = 100000;
+
+static std::string JournalPath(const std::string& workDir) {
+    return workDir + "\\.git\\ddobuildsync_fsmonitor.log";
+}
+
+// Named mutex held while the app is watching this work dir
+static std::string AliveMutexName(const std::string& workDir) {
+    std::string key = workDir;
+    for (char& c : key) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return "Local\\DDOBuildSync_fsmonitor_" + std::to_string(std::hash<std::string>()(key));
+}
+
+static std::string MakeToken(uint64_t session, uint64_t seq) {
+    return "ddobuildsync:" + std::to_string(session) + ":" + std::to_string(seq);
+}
+
+// ---------- FsmonitorJournal ----------
+
+bool FsmonitorJournal::Open(const std::string& workDir) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = JournalPath(workDir);
+    m_alive = CreateMutexA(nullptr, FALSE, AliveMutexName(workDir).c_str());
+    if (!m_alive) return false;
+    StartSessionLocked();
+    return m_file != INVALID_HANDLE_VALUE;
+}
+
+void FsmonitorJournal::Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+    if (m_alive) CloseHandle(m_alive);
+    m_alive = nullptr;
+}
+
+void FsmonitorJournal::StartSessionLocked() {
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+
+    // Unique per run and per reset, so old tokens never match. The clock
+    // ticks every ~15 ms, so two resets in one tick still get distinct ids.
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    uint64_t stamp = (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+    m_session = stamp > m_session ? stamp : m_session + 1;
+    m_seq = 0;
+
+    m_file = CreateFileA(m_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                         nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) return;
+    std::string header = "session " + std::to_string(m_session) + "\n";
+    DWORD written;
+    WriteFile(m_file, header.data(), static_cast<DWORD>(header.size()), &written, nullptr);
+}
+
+void FsmonitorJournal::Append(const std::string& relPath) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file == INVALID_HANDLE_VALUE) return;
+    if (m_seq >= kMaxJournalEntries) StartSessionLocked();
+
+    // One write per line, so a concurrent reader sees whole lines or a
+    // partial last line it can drop
+    std::string line = std::to_string(++m_seq) + " " + relPath + "\n";
+    DWORD written;
+    WriteFile(m_file, line.data(), static_cast<DWORD>(line.size()), &written, nullptr);
+}
+
+void FsmonitorJournal::Reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file != INVALID_HANDLE_VALUE) StartSessionLocked();
+}
+
+// ---------- FsWatcher ----------
+
+bool FsWatcher::Start(const std::string& workDir, const SyncRules& rules) {
+    Stop();
+    m_workDir = workDir;
+    m_rules = rules;
+
+    m_dir = CreateFileW(Utils::ToWide(workDir).c_str(), FILE_LIST_DIRECTORY,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (m_dir == INVALID_HANDLE_VALUE) return false;
+
+    if (!m_journal.Open(workDir)) {
+        CloseHandle(m_dir);
+        m_dir = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    m_stopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    m_thread = std::thread(&FsWatcher::Run, this);
+    return true;
+}
+
+void FsWatcher::Stop() {
+    if (m_thread.joinable()) {
+        SetEvent(m_stopEvent);
+        m_thread.join();
+    }
+    if (m_stopEvent) CloseHandle(m_stopEvent);
+    m_stopEvent = nullptr;
+    if (m_dir != INVALID_HANDLE_VALUE) CloseHandle(m_dir);
+    m_dir = INVALID_HANDLE_VALUE;
+    m_journal.Close();
+}
+
+void FsWatcher::Run() {
+    std::vector<DWORD> buffer(16 * 1024);   // 64 KB, DWORD-aligned as required
+    OVERLAPPED ov = {};
+    ov.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                         FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE |
+                         FILE_NOTIFY_CHANGE_CREATION;
+
+    for (;;) {
+        ResetEvent(ov.hEvent);
+        if (!ReadDirectoryChangesW(m_dir, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(DWORD)),
+                                   TRUE, filter, nullptr, &ov, nullptr)) {
+            break;
+        }
+
+        HANDLE waits[2] = {ov.hEvent, m_stopEvent};
+        DWORD w = WaitForMultipleObjects(2, waits, FALSE, INFINITE);
+        if (w != WAIT_OBJECT_0) {
+            CancelIoEx(m_dir, &ov);
+            DWORD ignored;
+            GetOverlappedResult(m_dir, &ov, &ignored, TRUE);
+            break;
+        }
+
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(m_dir, &ov, &bytes, FALSE)) {
+            if (GetLastError() != ERROR_NOTIFY_ENUM_DIR) break;
+            bytes = 0;
+        }
+        if (bytes == 0) {
+            // Buffer overflow: events were dropped
+            m_journal.Reset();
+            continue;
+        }
+
+        const char* p = reinterpret_cast<const char*>(buffer.data());
+        for (;;) {
+            auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p);
+            std::wstring wname(info->FileName, info->FileNameLength / sizeof(WCHAR));
+            std::string rel = Utils::ToUtf8(wname);
+            for (char& c : rel) {
+                if (c == '\\') c = '/';
+            }
+
+            // git never looks inside .git or at paths the rules ignore
+            bool inGitDir = rel == ".git" || rel.compare(0, 5, ".git/") == 0;
+            if (!inGitDir && (m_rules.MatchFile(rel) || m_rules.MatchDirectory(rel))) {
+                m_journal.Append(rel);
+                if (m_changeCb) m_changeCb();
+            }
+
+            if (info->NextEntryOffset == 0) break;
+            p += info->NextEntryOffset;
+        }
+    }
+    CloseHandle(ov.hEvent);
+
+    // Stopped, or the watch failed (folder deleted, handle invalid): either
+    // way nobody writes the journal any more, so release the alive mutex
+    // and the hook answers with a full scan until the watcher is restarted
+    m_journal.Close();
+}
+
+// ---------- Hook side ----------
+
+namespace Fsmonitor {
+
+std::string Answer(const std::string& workDir, const std::string& token) {
+    std::ifstream f(JournalPath(workDir), std::ios::binary);
+    std::string header;
+    uint64_t session = 0;
+    if (f.is_open() && std::getline(f, header) && header.compare(0, 8, "session ") == 0) {
+        session = std::strtoull(header.c_str() + 8, nullptr, 10);
+    }
+
+    // Only a journal the app is still writing can be trusted
+    HANDLE alive = OpenMutexA(SYNCHRONIZE, FALSE, AliveMutexName(workDir).c_str());
+    bool live = alive != nullptr && session != 0;
+    if (alive) CloseHandle(alive);
+
+    uint64_t since = 0;
+    bool known = false;
+    std::string prefix = "ddobuildsync:" + std::to_string(session) + ":";
+    if (live && token.compare(0, prefix.size(), prefix) == 0) {
+        since = std::strtoull(token.c_str() + prefix.size(), nullptr, 10);
+        known = true;
+    }
+
+    uint64_t last = 0;
+    std::set<std::string> paths;
+    std::string line;
+    // getline leaves a partial last line without its '\n' at EOF; skip it
+    while (live && std::getline(f, line)) {
+        if (f.eof()) break;
+        size_t space = line.find(' ');
+        if (space == std::string::npos) continue;
+        uint64_t seq = std::strtoull(line.c_str(), nullptr, 10);
+        last = seq;
+        if (known && seq > since) paths.insert(line.substr(space + 1));
+    }
+
+    std::string out = MakeToken(session, last);
+    out += '\0';
+    if (!known) {
+        out += "/";
+        out += '\0';
+        return out;
+    }
+    for (const auto& p : paths) {
+        out += p;
+        out += '\0';
+    }
+    return out;
+}
+
+} // namespace Fsmonitor
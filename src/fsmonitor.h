@@ -0,0 +1,73 @@
+#pragma once
+#include "sync_rules.h"
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Change journal shared between the app's watcher and git's fsmonitor hook
+// (ddobuildsync_cli fsmonitor). The app appends "<seq> <path>" lines to
+// .git\ddobuildsync_fsmonitor.log under a session id; the hook answers git
+// with the paths after the token git last got. While the app runs it holds
+// a named mutex, so the hook can tell a live journal from a stale one.
+class FsmonitorJournal {
+public:
+    ~FsmonitorJournal() { Close(); }
+
+    bool Open(const std::string& workDir);
+    void Close();
+
+    // Record a changed path ('/'-separated, relative to the work dir)
+    void Append(const std::string& relPath);
+
+    // Start a new session: changes may have been missed (watch buffer
+    // overflow), so every outstanding token must answer "everything"
+    void Reset();
+
+private:
+    std::mutex m_mutex;
+    std::string m_path;
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_alive = nullptr;
+    uint64_t m_session = 0;
+    uint64_t m_seq = 0;
+
+    void StartSessionLocked();
+};
+
+// Watches the builds folder (ReadDirectoryChangesW, recursive) and feeds
+// paths the sync rules can match into a FsmonitorJournal
+class FsWatcher {
+public:
+    ~FsWatcher() { Stop(); }
+
+    bool Start(const std::string& workDir, const SyncRules& rules);
+    void Stop();
+    bool IsRunning() const { return m_thread.joinable(); }
+
+    // Called on the watcher thread for every path it journals; set before Start
+    void SetChangeCallback(std::function<void()> cb) { m_changeCb = std::move(cb); }
+
+private:
+    std::string m_workDir;
+    SyncRules m_rules;
+    FsmonitorJournal m_journal;
+    std::function<void()> m_changeCb;
+    HANDLE m_dir = INVALID_HANDLE_VALUE;
+    HANDLE m_stopEvent = nullptr;
+    std::thread m_thread;
+
+    void Run();
+};
+
+namespace Fsmonitor {
+
+// Answer git's fsmonitor hook, protocol version 2: "<token>\0<path>\0...".
+// Anything the journal can't vouch for (app not running, other session,
+// unknown token) is answered with "/", i.e. "scan everything".
+std::string Answer(const std::string& workDir, const std::string& token);
+
+} // namespace Fsmonitor
@@ -0,0 +1,125 @@
+#include "git_filter.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace GitFilter {
+
+// pkt-line: 4 hex digits of total length (header included), then data.
+// "0000" is a flush packet.
+static const size_t kMaxPktData = 65516;
+
+enum class Pkt { Data, Flush, Eof };
+
+static Pkt ReadPkt(FILE* in, std::string& data) {
+    char header[5] = {};
+    if (fread(header, 1, 4, in) != 4) return Pkt::Eof;
+    char* end = nullptr;
+    unsigned long len = strtoul(header, &end, 16);
+    if (end != header + 4) return Pkt::Eof;
+    if (len == 0) return Pkt::Flush;
+    if (len < 4 || len - 4 > kMaxPktData) return Pkt::Eof;
+
+    data.resize(len - 4);
+    if (!data.empty() && fread(&data[0], 1, data.size(), in) != data.size()) return Pkt::Eof;
+    return Pkt::Data;
+}
+
+static bool WritePkt(FILE* out, const char* data, size_t size) {
+    char header[5];
+    snprintf(header, sizeof(header), "%04x", static_cast<unsigned>(size + 4));
+    return fwrite(header, 1, 4, out) == 4 && fwrite(data, 1, size, out) == size;
+}
+
+static bool WriteLine(FILE* out, const std::string& line) {
+    std::string text = line + "\n";
+    return WritePkt(out, text.data(), text.size());
+}
+
+static bool WriteFlush(FILE* out) {
+    return fwrite("0000", 1, 4, out) == 4;
+}
+
+static bool WriteContent(FILE* out, const std::string& content) {
+    for (size_t pos = 0; pos < content.size(); pos += kMaxPktData) {
+        size_t n = content.size() - pos < kMaxPktData ? content.size() - pos : kMaxPktData;
+        if (!WritePkt(out, content.data() + pos, n)) return false;
+    }
+    return WriteFlush(out);
+}
+
+// Text packets up to the next flush, trailing "\n" stripped. False on EOF.
+static bool ReadLines(FILE* in, std::vector<std::string>& lines) {
+    lines.clear();
+    std::string data;
+    for (;;) {
+        Pkt p = ReadPkt(in, data);
+        if (p == Pkt::Eof) return false;
+        if (p == Pkt::Flush) return true;
+        if (!data.empty() && data.back() == '\n') data.pop_back();
+        lines.push_back(data);
+    }
+}
+
+static bool ReadContent(FILE* in, std::string& content) {
+    content.clear();
+    std::string data;
+    for (;;) {
+        Pkt p = ReadPkt(in, data);
+        if (p == Pkt::Eof) return false;
+        if (p == Pkt::Flush) return true;
+        content += data;
+    }
+}
+
+int ServeProcess(FILE* in, FILE* out, const GitCleanFn& clean) {
+    std::vector<std::string> lines;
+
+    // Handshake: welcome + versions, then capabilities
+    if (!ReadLines(in, lines) || lines.empty() || lines[0] != "git-filter-client") return 1;
+    bool v2 = false;
+    for (const auto& l : lines) v2 = v2 || l == "version=2";
+    if (!v2) return 1;
+    WriteLine(out, "git-filter-server");
+    WriteLine(out, "version=2");
+    WriteFlush(out);
+    fflush(out);
+
+    if (!ReadLines(in, lines)) return 1;
+    bool canClean = false;
+    for (const auto& l : lines) canClean = canClean || l == "capability=clean";
+    if (canClean) WriteLine(out, "capability=clean");
+    WriteFlush(out);
+    fflush(out);
+
+    std::string content, filtered;
+    for (;;) {
+        // Git closing the pipe between requests is the normal shutdown
+        if (!ReadLines(in, lines)) return 0;
+
+        std::string command, path;
+        for (const auto& l : lines) {
+            if (l.compare(0, 8, "command=") == 0)  command = l.substr(8);
+            if (l.compare(0, 9, "pathname=") == 0) path = l.substr(9);
+        }
+        if (!ReadContent(in, content)) return 1;
+
+        if (command != "clean") {
+            WriteLine(out, "status=error");
+            WriteFlush(out);
+            fflush(out);
+            continue;
+        }
+
+        // A file we can't canonicalize is stored as-is rather than failing the add
+        if (!clean(path, content, filtered)) filtered = content;
+
+        WriteLine(out, "status=success");
+        WriteFlush(out);
+        WriteContent(out, filtered);
+        WriteFlush(out);        // empty list: status stays "success"
+        fflush(out);
+    }
+}
+
+} // namespace GitFilter
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdio>
+#include <functional>
+#include <string>
+
+// Clean filter callback: (repo path, file content, filtered content).
+// Return false to have git store the content unchanged.
+using GitCleanFn = std::function<bool(const std::string& path, const std::string& in,
+                                      std::string& out)>;
+
+namespace GitFilter {
+
+// Serve git's long-running filter protocol (filter.<driver>.process,
+// version 2) over in/out until git closes the pipe. One process filters
+// every file of an add/status, instead of one spawn per file.
+// Only "clean" is offered. Returns 0 on a normal shutdown.
+int ServeProcess(FILE* in, FILE* out, const GitCleanFn& clean);
+
+} // namespace GitFilter
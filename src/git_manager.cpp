@@ -1,101 +1,209 @@
 #include "git_manager.h"
 #include "utils.h"
+#include "trace.h"
+#include "git_trace2.h"
+#include "metrics.h"
+#include "process.h"
+#include "fast_import.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <map>
 #include <sstream>
+#include <mutex>
+#include <chrono>
+#include <thread>
+
+// git invocations slower than this get their trace2 breakdown logged
+static const double kSlowGitMs = 1000.0;
+
+// Last upstream main this repo was in step with (see GitManager::MarkUpstream)
+static const char* kUpstreamRef = "refs/ddobuildsync/upstream";
+
+// Unique temp file for one git child's trace2 events, UTF-8 (the temp
+// folder is under the user's profile, which may be outside the ANSI code page)
+static std::string MakeTrace2Path() {
+    static std::atomic<unsigned> s_counter{0};
+    wchar_t tempBuf[MAX_PATH];
+    GetTempPathW(MAX_PATH, tempBuf);
+    return Utils::ToUtf8(tempBuf) + "ddobuildsync_trace2_" +
+           std::to_string(GetCurrentProcessId()) + "_" +
+           std::to_string(s_counter++) + ".json";
+}
+
+// Whole file at a UTF-8 path
+static bool ReadFileUtf8Path(const std::string& path, std::string& out) {
+    HANDLE h = CreateFileW(Utils::ToWide(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    char buf[65536];
+    DWORD bytesRead;
+    while (ReadFile(h, buf, sizeof(buf), &bytesRead, nullptr) && bytesRead > 0) out.append(buf, bytesRead);
+    CloseHandle(h);
+    return true;
+}
+
+// Subcommand name for per-operation metrics: "--no-optional-locks status -z" -> "status"
+static std::string GitSubcommand(const std::string& args) {
+    std::istringstream iss(args);
+    std::string tok;
+    while (iss >> tok) {
+        if (!tok.empty() && tok[0] != '-') return tok;
+    }
+    return "git";
+}
+
+// Windows file names compare case-insensitively, as git does here (core.ignorecase)
+static bool EndsWithNoCase(const std::string& name, const char* suffix) {
+    size_t n = strlen(suffix);
+    return name.size() >= n && _stricmp(name.c_str() + name.size() - n, suffix) == 0;
+}
+
+// Second commit message paragraph: the builds in this commit, by file name
+static std::string CommitBody(const ChangeSet& changes) {
+    const size_t kMaxNames = 10;
+    std::string body;
+    size_t listed = 0;
+    for (const auto& e : changes.entries) {
+        if (listed == kMaxNames) break;
+        if (!body.empty()) body += ", ";
+        body += GitStatus::FileName(e.path);
+        listed++;
+    }
+    if (changes.entries.size() > listed)
+        body += " (+" + std::to_string(changes.entries.size() - listed) + " more)";
+    return body;
+}
 
 void GitManager::Log(const std::string& msg) {
     if (m_logCb) m_logCb(msg);
 }
 
 int GitManager::RunGit(const std::string& args, std::string& output) {
+    return RunGit(args, output, nullptr);
+}
+
+int GitManager::RunGit(const std::string& args, std::string& output,
+                       const std::function<void(const ProcessWriteFn&)>& stdinFeeder,
+                       int timeoutMs) {
+    return RunGit(args, output, stdinFeeder, timeoutMs, true);
+}
+
+int GitManager::RunGitQuiet(const std::string& args, std::string& output,
+                            const std::function<void(const ProcessWriteFn&)>& stdinFeeder) {
+    return RunGit(args, output, stdinFeeder, 0, false);
+}
+
+int GitManager::RunGit(const std::string& args, std::string& output,
+                       const std::function<void(const ProcessWriteFn&)>& stdinFeeder,
+                       int timeoutMs, bool logOutput, std::string* errorOutput) {
     output.clear();
+    if (errorOutput) errorOutput->clear();
+    if (m_cancel && WaitForSingleObject(m_cancel, 0) == WAIT_OBJECT_0) return -1;
 
     std::string cmdLine = "git " + args;
     Log("> " + cmdLine);
+    Trace::Span span("git", "process", args);
 
-    // Create pipes for stdout+stderr
-    SECURITY_ATTRIBUTES sa = {};
-    sa.nLength = sizeof(sa);
-    sa.bInheritHandle = TRUE;
+    ProcessRequest request;
+    request.commandLine = cmdLine;
+    request.workDir = m_workDir;
+    request.stdinFeeder = stdinFeeder;
+    request.timeoutMs = timeoutMs;
+    request.cancelEvent = m_cancel;
+    request.separateStderr = errorOutput != nullptr;
 
-    HANDLE hReadPipe = nullptr, hWritePipe = nullptr;
-    if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
-        Log("Failed to create pipe");
-        return -1;
+    // Per-invocation trace2 event file, parsed once the child has exited
+    std::string trace2Path;
+    if (m_trace2Enabled) {
+        trace2Path = MakeTrace2Path();
+        request.environment = Process::BuildEnvironment("GIT_TRACE2_EVENT", trace2Path);
     }
 
-    // Don't inherit the read end
-    SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
-
-    STARTUPINFOA si = {};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-    si.hStdOutput = hWritePipe;
-    si.hStdError = hWritePipe;
-    si.hStdInput = nullptr;
-    si.wShowWindow = SW_HIDE;
+    ProcessResult result = Process::Run(request);
+    if (!result.launched) {
+        Log("Failed to launch git (is git on PATH?)");
+        return -1;
+    }
+    output = std::move(result.output);
+    Process::RecordUsage("git." + GitSubcommand(args), result.usage);
 
-    PROCESS_INFORMATION pi = {};
+    if (logOutput) LogOutput(output);
+    if (errorOutput) {
+        *errorOutput = std::move(result.errorOutput);
+        LogOutput(*errorOutput);
+    }
 
-    // Need a mutable buffer for CreateProcessA
-    std::string cmdBuf = cmdLine;
+    if (!trace2Path.empty()) {
+        RecordTrace2(trace2Path);
+        DeleteFileW(Utils::ToWide(trace2Path).c_str());
+    }
 
-    BOOL ok = CreateProcessA(
-        nullptr,
-        cmdBuf.data(),
-        nullptr, nullptr,
-        TRUE,           // inherit handles
-        CREATE_NO_WINDOW,
-        nullptr,
-        m_workDir.empty() ? nullptr : m_workDir.c_str(),
-        &si, &pi
-    );
+    return result.exitCode;
+}
 
-    // Close write end in parent so ReadFile will return when child exits
-    CloseHandle(hWritePipe);
+void GitManager::LogOutput(const std::string& output) {
+    if (output.empty()) return;
 
-    if (!ok) {
-        CloseHandle(hReadPipe);
-        Log("Failed to launch git (is git on PATH?)");
-        return -1;
+    // -z output separates records with NUL instead of newlines
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find_first_of(std::string("\n\0", 2), start);
+        if (end == std::string::npos) end = output.size();
+        std::string line = output.substr(start, end - start);
+        start = end + 1;
+        // Trim trailing \r
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) Log("  " + line);
     }
+}
 
-    // Read all output
-    char buf[4096];
-    DWORD bytesRead;
-    while (ReadFile(hReadPipe, buf, sizeof(buf) - 1, &bytesRead, nullptr) && bytesRead > 0) {
-        buf[bytesRead] = '\0';
-        output += buf;
-    }
-    CloseHandle(hReadPipe);
+void GitManager::RecordTrace2(const std::string& path) {
+    Trace2Summary t;
+    std::string text;
+    if (!ReadFileUtf8Path(path, text) || !GitTrace2::ParseText(text, t) || t.command.empty()) return;
 
-    // Wait for process to finish
-    WaitForSingleObject(pi.hProcess, 30000); // 30s timeout
+    std::string prefix = "git." + t.command + ".";
+    Metrics::Record(prefix + "total_ms",       t.totalMs);
+    Metrics::Record(prefix + "network_ms",     t.networkMs);
+    Metrics::Record(prefix + "negotiation_ms", t.negotiationMs);
+    Metrics::Record(prefix + "index_ms",       t.indexMs);
+    Metrics::Record(prefix + "hooks_ms",       t.hooksMs);
 
-    DWORD exitCode = 0;
-    GetExitCodeProcess(pi.hProcess, &exitCode);
+    if (t.totalMs >= kSlowGitMs) Log("  " + GitTrace2::Format(t));
+}
 
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
+std::string GitManager::GetGitVersion() {
+    // git on PATH does not change while we run, so a found git is probed
+    // only once. A failure isn't cached: git may be installed meanwhile.
+    static std::mutex s_probeMutex;
+    static std::string s_version;
+    std::lock_guard<std::mutex> lock(s_probeMutex);
+    if (!s_version.empty()) return s_version;
 
-    // Log output lines
-    if (!output.empty()) {
-        std::istringstream iss(output);
-        std::string line;
-        while (std::getline(iss, line)) {
-            // Trim trailing \r
-            if (!line.empty() && line.back() == '\r') line.pop_back();
-            if (!line.empty()) Log("  " + line);
-        }
+    // Not through RunGit: a missing builds folder (as cwd) or a cancelled
+    // GitManager must not read as "git not found"
+    Log("> git --version");
+    ProcessRequest request;
+    request.commandLine = "git --version";
+    ProcessResult result = Process::Run(request);
+    if (!result.launched) {
+        Log("Failed to launch git (is git on PATH?)");
+        return "";
     }
-
-    return static_cast<int>(exitCode);
+    std::string output = result.output;
+    LogOutput(output);
+    if (result.exitCode != 0) return "";
+    while (!output.empty() && (output.back() == '\n' || output.back() == '\r'))
+        output.pop_back();
+    s_version = output;
+    return s_version;
 }
 
 bool GitManager::IsGitAvailable() {
-    std::string output;
-    int rc = RunGit("--version", output);
-    return rc == 0;
+    return !GetGitVersion().empty();
 }
 
 bool GitManager::IsRepoInitialized() {
@@ -104,23 +212,192 @@ bool GitManager::IsRepoInitialized() {
 
 bool GitManager::WriteGitIgnore() {
     std::string path = m_workDir + "\\.gitignore";
-    std::ofstream f(path);
+    std::string content = m_rules.ToGitIgnore();
+
+    // Rewriting an identical file would only touch its mtime
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream current;
+        current << in.rdbuf();
+        if (in.is_open() && current.str() == content) return true;
+    }
+
+    std::ofstream f(path, std::ios::binary);
     if (!f.is_open()) {
         Log("Failed to write .gitignore");
         return false;
     }
-    f << "# DDO Builder V2 - ignore everything except build files\n";
-    f << "*\n";
-    f << "\n";
-    f << "# Allow build files\n";
-    f << "!.gitignore\n";
-    f << "!*.DDOBuild\n";
-    f << "!*.DDOBuild.backup\n";
+    f << content;
     f.close();
     Log("Wrote .gitignore");
     return true;
 }
 
+bool GitManager::WriteGitAttributes() {
+    std::string path = m_workDir + "\\.gitattributes";
+    std::string current;
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream buf;
+        buf << in.rdbuf();
+        current = buf.str();
+    }
+
+    // Without the filter configured (canonicalizing off, or an older client)
+    // git just stores the files as they are; without the merge driver it
+    // merges them as text. Other lines, and other attributes on the
+    // *.DDOBuild line, are the user's and are kept.
+    std::string eol = current.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+    std::string content;
+    bool found = false;
+    std::istringstream lines(current);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream fields(line);
+        std::string pattern, attr;
+        fields >> pattern;
+        if (pattern == "*.DDOBuild" && !found) {
+            found = true;
+            line = pattern;
+            while (fields >> attr) {
+                std::string name = attr.substr(attr[0] == '-' || attr[0] == '!' ? 1 : 0);
+                name = name.substr(0, name.find('='));
+                if (name != "filter" && name != "merge") line += " " + attr;
+            }
+            line += " filter=ddobuild merge=ddobuild";
+        }
+        content += line + eol;
+    }
+    if (!found) content += "*.DDOBuild filter=ddobuild merge=ddobuild" + eol;
+
+    // Rewriting an identical file would only touch its mtime
+    if (content == current) return true;
+
+    std::ofstream f(path, std::ios::binary);
+    if (!f.is_open()) {
+        Log("Failed to write .gitattributes");
+        return false;
+    }
+    f << content;
+    f.close();
+    Log("Wrote .gitattributes");
+    return true;
+}
+
+bool GitManager::EnsureCleanFilter() {
+    if (m_filterChecked) return m_filterActive;
+    m_filterChecked = true;
+
+    std::string output;
+    if (!m_canonicalize) {
+        RunGit("config --remove-section filter.ddobuild", output);
+        return false;
+    }
+
+    std::string cli = Utils::GetExeDir() + "\\ddobuildsync_cli.exe";
+    if (!Utils::FileExists(cli)) {
+        Log("ddobuildsync_cli.exe not found; builds are stored without canonicalizing");
+        return false;
+    }
+    // git runs filters through its shell, which wants forward slashes
+    std::replace(cli.begin(), cli.end(), '\\', '/');
+
+    WriteGitAttributes();
+    m_filterActive =
+        RunGit("config filter.ddobuild.process \"\\\"" + cli + "\\\" filter-process\"", output) == 0 &&
+        RunGit("config filter.ddobuild.clean \"\\\"" + cli + "\\\" canonicalize\"", output) == 0;
+    return m_filterActive;
+}
+
+void GitManager::EnsureMergeDriver() {
+    if (m_mergeChecked) return;
+    m_mergeChecked = true;
+
+    std::string output;
+    std::string cli = Utils::GetExeDir() + "\\ddobuildsync_cli.exe";
+    if (!m_mergeBuilds || !Utils::FileExists(cli)) {
+        RunGit("config --remove-section merge.ddobuild", output);
+        return;
+    }
+    std::replace(cli.begin(), cli.end(), '\\', '/');
+
+    // git quotes each placeholder before running the driver through its shell
+    WriteGitAttributes();
+    RunGit("config merge.ddobuild.name \"DDO Builder build merge\"", output);
+    RunGit("config merge.ddobuild.driver \"\\\"" + cli + "\\\" merge-driver %O %A %B %P\"", output);
+}
+
+void GitManager::EnsureFsmonitor() {
+    if (m_fsmonitorChecked) return;
+    m_fsmonitorChecked = true;
+
+    std::string output;
+    std::string cli = Utils::GetExeDir() + "\\ddobuildsync_cli.exe";
+    if (!m_fsmonitor || !Utils::FileExists(cli)) {
+        RunGit("config --unset core.fsmonitor", output);
+        return;
+    }
+    std::replace(cli.begin(), cli.end(), '\\', '/');
+
+    // The hook answers "everything changed" whenever the app isn't watching,
+    // so leaving it configured while the app is closed is always safe
+    RunGit("config core.fsmonitor \"\\\"" + cli + "\\\" fsmonitor\"", output);
+    RunGit("config core.fsmonitorHookVersion 2", output);
+    RunGit("config core.untrackedCache true", output);
+}
+
+bool GitManager::BulkImportInitialCommit(const std::string& message) {
+    Trace::Span span("init.fast_import", "sync");
+    std::string output;
+
+    // fast-import needs an explicit identity; without one commit would fail too
+    ImportCommit commit;
+    commit.message = message;
+    if (RunGit("config user.name", output) != 0) return false;
+    commit.committerName = output.substr(0, output.find_first_of("\r\n"));
+    if (RunGit("config user.email", output) != 0) return false;
+    commit.committerEmail = output.substr(0, output.find_first_of("\r\n"));
+
+    std::vector<ImportFile> files = FastImport::ListFiles(m_workDir, m_rules);
+    uint64_t totalBytes = 0;
+    for (const auto& f : files) totalBytes += f.size;
+    Log("Importing " + std::to_string(files.size()) + " files (" +
+        std::to_string(totalBytes / 1024) + " KB) via fast-import");
+
+    // Same result the clean filter would give on `git add`
+    FastImport::ImportTransform canonicalize;
+    if (EnsureCleanFilter()) {
+        canonicalize = [this](const ImportFile& file, std::string& data) {
+            if (!EndsWithNoCase(file.relPath, ".DDOBuild")) return;
+            std::string out, error;
+            if (XmlCanonical::Canonicalize(data, out, m_canonicalOptions, error)) data.swap(out);
+        };
+    }
+
+    std::string streamError;
+    bool streamOk = false;
+    int rc = RunGit("fast-import --quiet --done --date-format=now", output,
+                    [&](const ProcessWriteFn& write) {
+                        streamOk = FastImport::WriteStream(files, commit, write, streamError,
+                                                           canonicalize);
+                    });
+    if (!streamOk || rc != 0) {
+        if (!streamError.empty()) Log(streamError);
+        Log("Bulk import failed, falling back to git add");
+        return false;
+    }
+
+    // HEAD must name the imported branch whichever default git init chose.
+    // Reset fills the index from the commit so the tree shows clean.
+    RunGit("symbolic-ref HEAD " + commit.ref, output);
+    if (RunGit("reset -q", output) != 0) {
+        Log("Failed to populate index after import");
+        return false;
+    }
+    return true;
+}
+
 bool GitManager::InitRepo() {
     if (m_workDir.empty()) {
         Log("Error: builds folder not set");
@@ -128,6 +405,7 @@ bool GitManager::InitRepo() {
     }
 
     Log("Initializing git repo in: " + m_workDir);
+    Trace::Span span("init", "sync");
 
     std::string output;
 
@@ -139,6 +417,9 @@ bool GitManager::InitRepo() {
 
     // Write .gitignore
     if (!WriteGitIgnore()) return false;
+    EnsureCleanFilter();
+    EnsureMergeDriver();
+    EnsureFsmonitor();
 
     // Set default branch to main
     RunGit("branch -M main", output);
@@ -152,49 +433,262 @@ bool GitManager::InitRepo() {
             return false;
         }
     }
+    EnsureMirrors();
 
-    // Add all build files (.gitignore whitelist handles filtering)
-    RunGit("add -A", output);
+    // Large libraries go through one fast-import stream (a single pack)
+    // rather than a loose object per file
+    if (!BulkImportInitialCommit("Initial commit - DDO Builder builds")) {
+        // Add all build files (.gitignore whitelist handles filtering)
+        RunGit("add -A", output);
 
-    // Initial commit
-    if (RunGit("commit -m \"Initial commit - DDO Builder builds\"", output) != 0) {
-        Log("Initial commit failed (maybe no build files yet?)");
-        // Not fatal - might be empty repo
+        // Initial commit
+        if (RunGit("commit -m \"Initial commit - DDO Builder builds\"", output) != 0) {
+            Log("Initial commit failed (maybe no build files yet?)");
+            // Not fatal - might be empty repo
+        }
     }
 
     // Push
     if (!m_repoUrl.empty()) {
-        if (RunGit("push -u origin main", output) != 0) {
+        if (!PushToRemotes(true)) {
             Log("Initial push failed - you may need to push manually");
             return false;
         }
+        MarkUpstream(HeadCommit());
     }
 
     Log("Repository initialized successfully");
     return true;
 }
 
+CloneResult GitManager::CloneExisting(int depth) {
+    if (m_workDir.empty() || m_repoUrl.empty()) return CloneResult::Failed;
+
+    Log("Checking remote for existing builds...");
+    Trace::Span span("clone", "sync");
+    std::string output;
+
+    if (RunGit("ls-remote --heads " + m_repoUrl + " main", output) != 0) {
+        Log("Could not reach remote");
+        return CloneResult::Failed;
+    }
+    if (output.find("refs/heads/main") == std::string::npos) {
+        Log("Remote has no builds yet");
+        return CloneResult::EmptyRemote;
+    }
+
+    // Clone beside the builds instead of over them; only .git is kept.
+    // A run that died half-way may have left one behind.
+    std::string tmpDir = m_workDir + "\\.ddobuildsync_clone";
+    if (Utils::DirExists(tmpDir) && !Utils::RemoveTree(tmpDir)) {
+        Log("Could not remove a leftover " + tmpDir);
+        return CloneResult::Failed;
+    }
+    Trace::Span cloneStage("clone.fetch", "sync");
+    int rc = RunGit("clone --no-checkout --filter=blob:none --depth " + std::to_string(depth) +
+                    " --branch main " + m_repoUrl + " \"" + tmpDir + "\"", output);
+    cloneStage.End();
+    if (rc != 0) {
+        Utils::RemoveTree(tmpDir);
+        Log("Clone failed");
+        return CloneResult::Failed;
+    }
+
+    if (!MoveFileExA((tmpDir + "\\.git").c_str(), (m_workDir + "\\.git").c_str(), 0)) {
+        Utils::RemoveTree(tmpDir);
+        Log("Failed to move cloned repo into builds folder");
+        return CloneResult::Failed;
+    }
+    RemoveDirectoryA(tmpDir.c_str());
+    EnsureCleanFilter();
+    EnsureMergeDriver();
+    EnsureFsmonitor();
+    EnsureMirrors();
+
+    // Index from HEAD without touching the working tree: builds that exist
+    // locally and differ from the remote show up as modified, not replaced
+    Trace::Span adoptStage("clone.adopt", "sync");
+    if (RunGit("reset -q", output) != 0) {
+        Log("Failed to build index from remote");
+        return CloneResult::Failed;
+    }
+
+    // Whatever is still missing only exists on the remote; checkout fetches
+    // those blobs in one batch
+    std::string missing;
+    RunGit("ls-files --deleted -z", missing);
+    if (!missing.empty()) {
+        size_t count = std::count(missing.begin(), missing.end(), '\0');
+        Log("Checking out " + std::to_string(count) + " builds from remote");
+        rc = RunGit("checkout --pathspec-from-file=- --pathspec-file-nul -- ", output,
+                    [&missing](const ProcessWriteFn& write) {
+                        write(missing.data(), missing.size());
+                    });
+        if (rc != 0) {
+            Log("Checkout of remote builds failed");
+            return CloneResult::Failed;
+        }
+    }
+
+    MarkUpstream(HeadCommit());
+    Log("Cloned existing builds repo");
+    return CloneResult::Cloned;
+}
+
+bool GitManager::HydrateHistory() {
+    std::string output;
+    if (RunGit("rev-parse --is-shallow-repository", output) != 0) return false;
+    if (output.find("true") == std::string::npos) return true;
+
+    Log("Fetching full build history...");
+    Trace::Span span("hydrate", "sync");
+    if (RunGit("fetch --unshallow --filter=blob:none origin main", output) != 0) {
+        Log("History fetch failed; will retry on next auto-sync");
+        return false;
+    }
+    Log("Full build history available");
+    return true;
+}
+
 bool GitManager::Pull() {
     if (!IsRepoInitialized()) {
         Log("Error: repository not initialized");
         return false;
     }
 
+    Recover();
     Log("Pulling latest builds...");
+    Trace::Span span("pull", "sync");
     std::string output;
+    EnsureMergeDriver();
+    EnsureMirrors();
+    m_journal.Begin("pull", "");
+
+    // Only the fetches talk to the remotes. origin and every healthy mirror
+    // are fetched at once, each bounded by its own timeout, since a mirror
+    // may be behind origin or hold commits origin doesn't have yet; the
+    // unhealthy mirrors only when none of those answered. Each fetch
+    // updates only its own tracking ref (no shared FETCH_HEAD).
+    Trace::Span fetchStage("pull.fetch", "sync");
+    std::vector<std::string> ranked = RankRemotes();
+    std::map<std::string, std::string> lastFetched;
+    std::vector<char> healthy(ranked.size(), 0), fetched(ranked.size(), 0), tried(ranked.size(), 0);
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        lastFetched[ranked[i]] = TrackingTip(ranked[i]);
+        healthy[i] = ranked[i] == "origin" || RemoteHealthy(ranked[i]);
+    }
 
-    int rc = RunGit("pull origin main --rebase", output);
+    auto fetchAll = [&](bool healthyOnes) {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < ranked.size(); ++i) {
+            const std::string& r = ranked[i];
+            if ((healthy[i] != 0) != healthyOnes) continue;
+            tried[i] = 1;
+            threads.emplace_back([this, &r, &fetched, i]() {
+                std::string fetchOutput;
+                auto start = std::chrono::steady_clock::now();
+                fetched[i] = RunGit("fetch --no-write-fetch-head " + r + " main", fetchOutput, nullptr,
+                                    m_remoteTimeoutMs) == 0;
+                RecordRemote(r, "fetch", std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - start).count(), fetched[i] != 0);
+            });
+        }
+        for (auto& t : threads) t.join();
+    };
+    fetchAll(true);
+    if (std::find(fetched.begin(), fetched.end(), 1) == fetched.end()) fetchAll(false);
+    fetchStage.End();
+
+    // In RankRemotes order, so ties go to the fastest remote
+    std::vector<std::string> fetchedFrom;
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        if (fetched[i]) fetchedFrom.push_back(ranked[i]);
+        else if (tried[i]) Log("Fetch from " + ranked[i] + " failed");
+    }
+    if (fetchedFrom.empty()) {
+        m_journal.End("failed");
+        Log("Pull failed");
+        return false;
+    }
+
+    // Build on the most advanced tip: the one every other fetched tip is
+    // contained in. Remotes that diverged (a mirror took a push origin
+    // refused) defer to origin; the next push realigns the mirrors.
+    std::string remote = fetchedFrom[0];
+    std::string best = TrackingTip(remote);
+    for (size_t i = 1; i < fetchedFrom.size(); ++i) {
+        const std::string& r = fetchedFrom[i];
+        std::string tip = TrackingTip(r);
+        if (tip == best || RunGitQuiet("merge-base --is-ancestor " + tip + " " + best, output) == 0) continue;
+        bool ahead = RunGitQuiet("merge-base --is-ancestor " + best + " " + tip, output) == 0;
+        if (!ahead) Log(remote + " and " + r + " have diverged; following " + (r == "origin" ? r : remote));
+        if (ahead || r == "origin") {
+            remote = r;
+            best = tip;
+        }
+    }
+
+    // --autostash: the background sync pulls before committing local edits
+    Trace::Span rebaseStage("pull.rebase", "sync");
+    m_journal.Current().remote = remote;
+    m_journal.Stage("rebase");
+
+    // main neither contains nor is contained in the upstream we were last
+    // in step with: another machine compacted history (see HistoryCompactor).
+    // Only commits made here since then are ours; the rest are already in the
+    // rewritten main. The base is our own ref, not the tracking ref the fetch
+    // just moved, so a failed replay is detected again on the next pull.
+    std::string previous;
+    if (RunGitQuiet(std::string("rev-parse -q --verify ") + kUpstreamRef, output) == 0) {
+        previous = output.substr(0, output.find_first_of("\r\n"));
+    } else {
+        previous = lastFetched[remote];
+    }
+    if (!previous.empty() && best != previous &&
+        RunGitQuiet("merge-base --is-ancestor " + previous + " " + best, output) == 1 &&
+        RunGitQuiet("merge-base --is-ancestor " + best + " " + previous, output) == 1) {
+        Log("Remote history was compacted; replaying only local commits");
+        int rc = RunGit("rebase --autostash --onto " + remote + "/main " + previous, output);
+        rebaseStage.End();
+        if (rc != 0) {
+            // Merging would bring the old history back in; leave it as it was
+            RunGit("rebase --abort", output);
+            m_journal.End("failed");
+            Log("Pull failed - local commits conflict with the compacted history");
+            return false;
+        }
+        m_journal.End("ok");
+        MarkUpstream(best);
+        m_history.Update();
+        Log("Pull complete");
+        return true;
+    }
+
+    int rc = RunGit("rebase --autostash " + remote + "/main", output);
+    rebaseStage.End();
     if (rc != 0) {
+        Trace::Span mergeStage("pull.merge_fallback", "sync");
+        // A conflicting rebase stops half-way; leave the tree as it was
+        // so the plain merge below can run
+        std::string abortOut;
+        RunGit("rebase --abort", abortOut);
+
         // Try without --rebase in case of issues
         Log("Pull with rebase failed, trying regular pull...");
-        rc = RunGit("pull origin main", output);
+        m_journal.Stage("merge");
+        rc = RunGit("merge --no-edit --autostash " + remote + "/main", output);
         if (rc != 0) {
+            // A conflicted merge is left for the user, not rolled back
+            m_journal.End("conflict");
             Log("Pull failed");
             return false;
         }
     }
 
-    Log("Pull complete");
+    m_journal.End("ok");
+    MarkUpstream(best);
+    m_history.Update();
+    Log(remote == "origin" ? "Pull complete" : "Pull complete (from " + remote + ")");
     return true;
 }
 
@@ -204,44 +698,327 @@ bool GitManager::Push() {
         return false;
     }
 
+    Recover();
     Log("Pushing builds...");
+    Trace::Span span("push", "sync");
     std::string output;
 
+    // Picks up sync rule changes (and whitelists .gitattributes in old repos)
+    WriteGitIgnore();
+    EnsureCleanFilter();
+    EnsureMergeDriver();
+    EnsureFsmonitor();
+    EnsureMirrors();
+    m_journal.Begin("push", HeadCommit());
+
+    // A pull that ended in a conflicted merge leaves unmerged entries; add -A
+    // would stage them, markers and all, so check before staging
+    if (RunGitQuiet("ls-files -u", output) == 0 && !output.empty()) {
+        m_journal.End("failed");
+        Log("Conflicted file(s) from the last pull - resolve them before pushing");
+        return false;
+    }
+
     // Stage all changes (additions, modifications, and deletions)
     // .gitignore whitelist ensures only build files are tracked
+    Trace::Span stageStage("push.stage", "sync");
     RunGit("add -A", output);
+    stageStage.End();
+
+    // Finishing a merge: its resolution must not still hold conflict markers
+    if (Utils::FileExists(m_workDir + "\\.git\\MERGE_HEAD") &&
+        RunGitQuiet("diff --cached --check", output) != 0 &&
+        output.find("conflict marker") != std::string::npos) {
+        m_journal.End("failed");
+        Log("Build files still contain conflict markers - resolve them before pushing");
+        return false;
+    }
 
-    // Check if there are changes
-    int changedCount = GetChangedFileCount();
-    if (changedCount == 0) {
+    // What to commit, and whether earlier commits are still unpushed
+    Trace::Span statusStage("push.status", "sync");
+    ChangeSet changes;
+    bool known = GetStatus(changes);
+    statusStage.End();
+    if (known && !changes.NeedsPush()) {
+        m_journal.Current().pushPending = false;
+        m_journal.End("ok");
         Log("No changes to push");
         return true;
     }
 
-    // Commit
-    std::string timestamp = Utils::GetTimestamp();
-    std::string commitMsg = "Update builds - " + timestamp;
-    if (RunGit("commit -m \"" + commitMsg + "\"", output) != 0) {
-        Log("Commit failed");
-        return false;
+    // Commit (nothing to commit: a previous push didn't go through)
+    if (!known || changes.ChangedCount() > 0) {
+        Trace::Span commitStage("push.commit", "sync");
+        std::string timestamp = Utils::GetTimestamp();
+        std::string commitMsg = "Update builds - " + timestamp;
+        std::string args = "commit -m \"" + commitMsg + "\"";
+        if (known) args += " -m \"" + CommitBody(changes) + "\"";
+        m_journal.Stage("commit");
+        if (RunGit(args, output) != 0) {
+            m_journal.End("failed");
+            Log("Commit failed");
+            return false;
+        }
+        m_journal.Current().after = HeadCommit();
+    } else {
+        Log("Pushing " + std::to_string(changes.ahead) + " earlier commit(s)");
     }
 
-    // Push
-    if (RunGit("push origin main", output) != 0) {
+    // Push; from here the commit is owed to the remotes until one takes it
+    Trace::Span uploadStage("push.upload", "sync");
+    m_journal.Current().pushPending = true;
+    m_journal.Stage("upload");
+    bool pushed = PushToRemotes(false);
+    if (!pushed) {
+        m_journal.Stage("rebase");
+        if (CatchUpWithOrigin()) {
+            m_journal.Current().after = HeadCommit();
+            m_journal.Stage("upload");
+            pushed = PushToRemotes(false);
+        }
+    }
+    if (!pushed) {
+        m_journal.End("failed");
         Log("Push failed");
         return false;
     }
 
+    m_journal.Current().pushPending = false;
+    m_journal.End("ok");
+    MarkUpstream(HeadCommit());
+    m_history.Update();
     Log("Push complete");
     return true;
 }
 
-int GitManager::GetChangedFileCount() {
+std::string GitManager::HeadCommit() {
     std::string output;
-    if (RunGit("status --porcelain", output) != 0) {
-        return -1;
+    if (RunGit("rev-parse -q --verify HEAD", output) != 0) return "";
+    size_t end = output.find_first_of("\r\n");
+    return output.substr(0, end);
+}
+
+bool GitManager::Recover() {
+    if (m_recoveryChecked) return true;
+    m_recoveryChecked = true;
+
+    // One small read of the journal's tail when the last run finished cleanly
+    OpRecord last;
+    if (!m_journal.Last(last)) return true;
+    bool finished = last.stage == "done";
+    if (finished && !last.pushPending) return true;
+    if (m_journal.IsRunning()) return true;     // another process is mid-sync, not interrupted
+
+    Trace::Span span("recover", "sync", last.op + "." + last.stage);
+    std::string gitDir = m_workDir + "\\.git";
+    std::string output;
+    bool owed = last.pushPending;
+
+    if (!finished && (last.op == "pull" || (last.op == "push" && last.stage == "rebase"))) {
+        // Both aborts restore the autostashed local edits
+        if (Utils::DirExists(gitDir + "\\rebase-merge") || Utils::DirExists(gitDir + "\\rebase-apply")) {
+            RunGit("rebase --abort", output);
+            Log("Rolled back a pull that was interrupted mid-rebase");
+        } else if (Utils::FileExists(gitDir + "\\MERGE_HEAD")) {
+            RunGit("merge --abort", output);
+            Log("Rolled back a pull that was interrupted mid-merge");
+        }
+    } else if (!finished && last.op == "compact") {
+        // Stopped around the forced push: follow whichever main origin took
+        if (last.stage != "archive" && TrackingTip("origin") == last.after && HeadCommit() == last.before) {
+            RunGit("reset --keep " + last.after, output);
+            MarkUpstream(last.after);
+            Log("Finished an interrupted history compaction");
+        }
+        owed = false;
+    } else if (!finished && last.op == "push" && last.stage == "commit") {
+        // Killed during `git commit`: owed only if the commit landed
+        owed = HeadCommit() != last.before;
     }
 
+    if (!owed) {
+        m_journal.Begin(last.op, "");
+        m_journal.Current().pushPending = false;
+        m_journal.End("recovered");
+        return true;
+    }
+
+    Log("Resuming push of commits an interrupted sync left behind...");
+    EnsureMirrors();
+    m_journal.Begin("push", last.before);
+    m_journal.Current().after = HeadCommit();
+    m_journal.Current().pushPending = true;
+    m_journal.Stage("upload");
+    bool ok = PushToRemotes(false);
+    if (ok) MarkUpstream(HeadCommit());
+    m_journal.Current().pushPending = !ok;
+    m_journal.End(ok ? "recovered" : "failed");
+    Log(ok ? "Interrupted push completed" : "Resumed push failed - will retry on the next sync");
+    return ok;
+}
+
+void GitManager::MarkUpstream(const std::string& commit) {
+    if (commit.empty()) return;
+    std::string output;
+    RunGitQuiet(std::string("update-ref ") + kUpstreamRef + " " + commit, output);
+}
+
+std::string GitManager::TrackingTip(const std::string& remote) {
+    std::string output;
+    if (RunGitQuiet("rev-parse -q --verify refs/remotes/" + remote + "/main", output) != 0) return "";
+    return output.substr(0, output.find_first_of("\r\n"));
+}
+
+std::vector<std::string> GitManager::RemoteNames() const {
+    std::vector<std::string> names = {"origin"};
+    for (size_t i = 0; i < m_mirrorUrls.size(); ++i) names.push_back("mirror" + std::to_string(i + 1));
+    return names;
+}
+
+void GitManager::EnsureMirrors() {
+    if (m_mirrorsChecked) return;
+    m_mirrorsChecked = true;
+
+    std::string output;
+    for (size_t i = 0; i < m_mirrorUrls.size(); ++i) {
+        std::string name = "mirror" + std::to_string(i + 1);
+        if (RunGit("remote set-url " + name + " " + m_mirrorUrls[i], output) != 0 &&
+            RunGit("remote add " + name + " " + m_mirrorUrls[i], output) != 0) {
+            Log("Failed to add mirror " + m_mirrorUrls[i]);
+        }
+    }
+
+    // Mirrors removed from the config
+    if (RunGit("remote", output) != 0) return;
+    std::istringstream iss(output);
+    std::string name;
+    while (iss >> name) {
+        if (name.compare(0, 6, "mirror") != 0) continue;
+        int index = std::atoi(name.c_str() + 6);
+        if (index < 1 || index > static_cast<int>(m_mirrorUrls.size())) {
+            std::string removeOut;
+            RunGit("remote remove " + name, removeOut);
+        }
+    }
+}
+
+void GitManager::RecordRemote(const std::string& remote, const char* op, double ms, bool ok) {
+    // A timed-out or failed call says nothing about latency, only health
+    if (ok) Metrics::Record("remote." + remote + "." + op + "_ms", ms);
+    Metrics::Record("remote." + remote + ".ok", ok ? 1.0 : 0.0);
+}
+
+bool GitManager::RemoteHealthy(const std::string& remote) {
+    auto metrics = Metrics::Snapshot();
+    auto ok = metrics.find("remote." + remote + ".ok");
+    return ok == metrics.end() || ok->second.last > 0.5;
+}
+
+std::vector<std::string> GitManager::RankRemotes() {
+    struct Rank {
+        std::string name;
+        bool healthy;
+        double latencyMs;
+        size_t order;
+    };
+
+    auto metrics = Metrics::Snapshot();
+    auto median = [&metrics](const std::string& key) {
+        auto it = metrics.find(key);
+        return it == metrics.end() || it->second.window.empty() ? -1.0 : it->second.Percentile(0.5);
+    };
+
+    std::vector<Rank> ranks;
+    std::vector<std::string> names = RemoteNames();
+    for (size_t i = 0; i < names.size(); ++i) {
+        const std::string& r = names[i];
+        bool healthy = RemoteHealthy(r);
+        double latency = median("remote." + r + ".fetch_ms");
+        if (latency < 0) latency = median("remote." + r + ".push_ms");
+        // Never measured: try it early so it gets a measurement
+        if (latency < 0) latency = 0;
+        ranks.push_back({r, healthy, latency, i});
+    }
+
+    std::sort(ranks.begin(), ranks.end(), [](const Rank& a, const Rank& b) {
+        if (a.healthy != b.healthy) return a.healthy;
+        if (a.latencyMs != b.latencyMs) return a.latencyMs < b.latencyMs;
+        return a.order < b.order;
+    });
+
+    std::vector<std::string> out;
+    for (const auto& r : ranks) out.push_back(r.name);
+    return out;
+}
+
+bool GitManager::PushToRemotes(bool setUpstream) {
+    std::vector<std::string> remotes = RemoteNames();
+    std::vector<char> ok(remotes.size(), 0);
+
+    // One thread per remote; each push is bounded by its own timeout, so the
+    // slowest mirror only delays this call, never the other pushes. Mirrors
+    // are copies of origin and a commit only counts as pushed once origin has
+    // it, so a mirror that diverged is moved to our main (leased against what
+    // we last fetched from it).
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < remotes.size(); ++i) {
+        threads.emplace_back([this, &remotes, &ok, i, setUpstream]() {
+            const std::string& r = remotes[i];
+            std::string output;
+            std::string args;
+            if (r == "origin") args = setUpstream ? "push -u origin main" : "push origin main";
+            else args = "push --force-with-lease=main " + r + " main";
+            auto start = std::chrono::steady_clock::now();
+            ok[i] = RunGit(args, output, nullptr, m_remoteTimeoutMs) == 0;
+            RecordRemote(r, "push", std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - start).count(), ok[i] != 0);
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    for (size_t i = 1; i < remotes.size(); ++i) {
+        if (!ok[i]) Log("Push to " + remotes[i] + " failed; it catches up on a later push");
+    }
+    if (!ok[0] && remotes.size() > 1) Log("Push to origin failed; the commit stays owed until origin takes it");
+    return ok[0] != 0;
+}
+
+bool GitManager::CatchUpWithOrigin() {
+    // Only a rejected push is worth retrying: origin answered and has
+    // commits that aren't here yet
+    std::string output;
+    if (RunGit("fetch origin main", output, nullptr, m_remoteTimeoutMs) != 0) return false;
+    std::string tip = TrackingTip("origin");
+    if (tip.empty() || RunGitQuiet("merge-base --is-ancestor " + tip + " HEAD", output) == 0) return false;
+
+    Log("origin has newer commits; rebasing before pushing again");
+    if (RunGit("rebase --autostash origin/main", output) != 0) {
+        RunGit("rebase --abort", output);
+        Log("Local commits conflict with origin; they are pushed after the next pull");
+        return false;
+    }
+    return true;
+}
+
+bool GitManager::GetStatus(ChangeSet& out) {
+    std::string output, errors;
+    // --no-optional-locks: don't take index.lock, so a background status
+    // probe can't collide with a pull/push running on the worker thread.
+    // Only stdout is parsed: warnings (CRLF, the clean filter) go to stderr.
+    if (RunGit("--no-optional-locks status --porcelain=v2 -z --branch", output, nullptr, 0, true,
+               &errors) != 0) {
+        return false;
+    }
+    return GitStatus::Parse(std::move(output), out);
+}
+
+int GitManager::GetChangedFileCount() {
+    ChangeSet changes;
+    if (!GetStatus(changes)) return -1;
+    return changes.ChangedCount();
+}
+
+int GitManager::CountPorcelainEntries(const std::string& output) {
     if (output.empty()) return 0;
 
     int count = 0;
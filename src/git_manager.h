@@ -1,47 +1,239 @@
 #pragma once
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include "process.h"
+#include "xml_canonical.h"
+#include "sync_rules.h"
+#include "git_status.h"
+#include "history_index.h"
+#include "op_journal.h"
 #include <string>
 #include <functional>
 
+enum class CloneResult {
+    Cloned,         // builds folder now tracks the remote's main branch
+    EmptyRemote,    // remote reachable but has no main branch yet
+    Failed
+};
+
 // Callback for log output: (message)
 using GitLogCallback = std::function<void(const std::string&)>;
 
 class GitManager {
 public:
-    void SetWorkDir(const std::string& dir) { m_workDir = dir; }
+    GitManager() = default;
+    GitManager(const GitManager&) = delete;
+    GitManager& operator=(const GitManager&) = delete;
+    ~GitManager() { if (m_cancel) CloseHandle(m_cancel); }
+
+    void SetWorkDir(const std::string& dir) {
+        m_workDir = dir;
+        m_journal.SetWorkDir(dir);
+        m_history.SetWorkDir(dir);
+    }
     void SetRepoUrl(const std::string& url) { m_repoUrl = url; }
+
+    // Extra remotes ("mirror1".."mirrorN") kept in step with origin: pushes
+    // go to every remote in parallel, pulls fetch origin and the healthy
+    // mirrors in parallel and build on the most advanced tip that answered
+    void SetMirrorUrls(const std::vector<std::string>& urls) { m_mirrorUrls = urls; }
+
+    // Each remote's fetch/push is killed after this long (0 = no limit), so
+    // one slow mirror can't hold up the others
+    void SetRemoteTimeoutMs(int ms) { m_remoteTimeoutMs = ms; }
+    int RemoteTimeoutMs() const { return m_remoteTimeoutMs; }
     void SetLogCallback(GitLogCallback cb) { m_logCb = std::move(cb); }
 
-    // Check if git is available on PATH
+    // Kill the running git child and fail every later git call at once, so
+    // a Pull/Push in flight on another thread returns promptly (shutdown).
+    // What it leaves half-done is finished by Recover() on the next run.
+    void Cancel() { if (m_cancel) SetEvent(m_cancel); }
+
+    // Have each git child write a trace2 event stream (GIT_TRACE2_EVENT) and
+    // record its network/negotiation/index/hook time in Metrics
+    void SetTrace2Enabled(bool enabled) { m_trace2Enabled = enabled; }
+
+    // Which files are synced; drives the generated .gitignore and the bulk import
+    void SetSyncRules(const SyncRules& rules) { m_rules = rules; }
+    const SyncRules& GetSyncRules() const { return m_rules; }
+
+    // Store *.DDOBuild in canonical form: registers ddobuildsync_cli as the
+    // repo's clean filter, and the bulk import applies the same transform
+    void SetCanonicalize(bool enabled, const CanonicalOptions& options) {
+        m_canonicalize = enabled;
+        m_canonicalOptions = options;
+    }
+
+    // Point core.fsmonitor at ddobuildsync_cli (answered from the app's
+    // watcher journal) and turn on the untracked cache, so status and add
+    // only look at paths that changed
+    void SetFsmonitor(bool enabled) { m_fsmonitor = enabled; }
+
+    // Register ddobuildsync_cli as the repo's merge driver for *.DDOBuild,
+    // so pulls merge concurrent edits element by element (see XmlMerge)
+    void SetMergeBuilds(bool enabled) { m_mergeBuilds = enabled; }
+
+    // Check if git is available on PATH (cached once found)
     bool IsGitAvailable();
 
+    // Output of `git --version`, or empty if git could not be run.
+    // Once git is found, later calls return the cached result; a failed
+    // probe is retried on the next call.
+    std::string GetGitVersion();
+
     // Check if .git exists in work dir
     bool IsRepoInitialized();
 
     // Initialize repo: git init, write .gitignore, add remote, initial commit+push
     bool InitRepo();
 
-    // git pull origin main --rebase
+    // Set up the builds folder from an existing remote: shallow, blob-less
+    // clone of main next to it, move its .git in, then keep local build files
+    // as changes on top and check out the ones only the remote has.
+    CloneResult CloneExisting(int depth = 1);
+
+    // Fetch the commit history a shallow clone left out (blobs stay lazy).
+    // No-op on a full repo. Slow on big histories; run in the background.
+    bool HydrateHistory();
+
+    // Finish or undo the pull/push an earlier run left open (app closed or
+    // crashed mid-sync), from the last record of the operation journal:
+    // a half-applied rebase or merge is aborted, a commit that never reached
+    // a remote is pushed. Pull and Push call this first, once per GitManager.
+    // False if a resumed push failed (it stays owed).
+    bool Recover();
+
+    // Fetch main from origin and every healthy mirror at once (see
+    // RankRemotes), then rebase onto the most advanced of them (falls back
+    // to a merge)
     bool Pull();
 
-    // git add builds, commit with timestamp, push
+    // git add builds, commit with timestamp, push to every remote. True once
+    // origin has the commits; a push origin rejects is rebased onto origin's
+    // main and retried once.
     bool Push();
 
+    // origin, then the mirrors, ordered for pulling: healthy remotes
+    // (last operation succeeded) first, then by median recent latency
+    std::vector<std::string> RankRemotes();
+
+    // Per-build commit index, brought up to date after every Pull and Push
+    HistoryIndex& History() { return m_history; }
+
+    // Record that main is in step with upstream main at commit (after a pull,
+    // push, clone or compaction). Pull tells a rewritten remote main from one
+    // that moved on by comparing against this, not the remote-tracking ref.
+    void MarkUpstream(const std::string& commit);
+
+    // Stage journal that Recover() replays (HistoryCompactor adds "compact")
+    OpJournal& Journal() { return m_journal; }
+
+    // All remote names: origin, then mirror1..N
+    std::vector<std::string> RemoteNames() const;
+
+    // `git status --porcelain=v2 -z --branch`: changed paths, conflicts
+    // and ahead/behind the upstream in one spawn. False if git failed.
+    bool GetStatus(ChangeSet& out);
+
     // Returns count of changed files, or -1 on error
     int GetChangedFileCount();
 
+    // Count entries in `git status --porcelain` output
+    static int CountPorcelainEntries(const std::string& output);
+
+    // Run a git command, capture combined stdout+stderr output.
+    // Returns the process exit code, or -1 on failure to launch.
+    int RunGit(const std::string& args, std::string& output);
+
+    // Same, with the child's stdin fed by stdinFeeder on a separate thread,
+    // and the child tree killed after timeoutMs (0 = no limit)
+    int RunGit(const std::string& args, std::string& output,
+               const std::function<void(const ProcessWriteFn&)>& stdinFeeder,
+               int timeoutMs = 0);
+
+    // Same, without forwarding the output to the log (blob contents)
+    int RunGitQuiet(const std::string& args, std::string& output,
+                    const std::function<void(const ProcessWriteFn&)>& stdinFeeder = nullptr);
+
+    // Full id of HEAD, or "" on an unborn branch
+    std::string HeadCommit();
+
+    // Forward each non-empty line of git output to the log callback
+    void LogOutput(const std::string& output);
+
 private:
     std::string m_workDir;
     std::string m_repoUrl;
+    HANDLE m_cancel = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    std::vector<std::string> m_mirrorUrls;
+    int m_remoteTimeoutMs = 0;
+    bool m_mirrorsChecked = false;
     GitLogCallback m_logCb;
+    bool m_trace2Enabled = false;
+    SyncRules m_rules = SyncRules::Default();
+    bool m_canonicalize = false;
+    CanonicalOptions m_canonicalOptions;
+    bool m_filterChecked = false;
+    bool m_filterActive = false;
+    bool m_mergeBuilds = false;
+    bool m_mergeChecked = false;
+    bool m_fsmonitor = false;
+    bool m_fsmonitorChecked = false;
+    OpJournal m_journal;
+    HistoryIndex m_history{*this};
+    bool m_recoveryChecked = false;
 
     void Log(const std::string& msg);
 
-    // Run a git command, capture combined stdout+stderr output.
-    // Returns the process exit code, or -1 on failure to launch.
-    int RunGit(const std::string& args, std::string& output);
+    // errorOutput set: stderr goes there (and to the log), output is stdout only
+    int RunGit(const std::string& args, std::string& output,
+               const std::function<void(const ProcessWriteFn&)>& stdinFeeder,
+               int timeoutMs, bool logOutput, std::string* errorOutput = nullptr);
+
+    // Parse a finished child's trace2 file (UTF-8 path) into Metrics (and the log if slow)
+    void RecordTrace2(const std::string& path);
 
-    // Write .gitignore for DDO Builder folder
+    // Write the .gitignore generated from the sync rules (if it changed)
     bool WriteGitIgnore();
+
+    // Make .gitattributes route *.DDOBuild through the "ddobuild" filter and
+    // merge driver, keeping the user's other lines; written only if changed
+    bool WriteGitAttributes();
+
+    // Point the repo's "ddobuild" filter at ddobuildsync_cli (or remove it
+    // when canonicalizing is off). Runs once per GitManager; returns true
+    // if git will canonicalize builds on add.
+    bool EnsureCleanFilter();
+
+    // Point the repo's "ddobuild" merge driver at ddobuildsync_cli (or
+    // remove it when merging builds is off); once per GitManager
+    void EnsureMergeDriver();
+
+    // Apply the fsmonitor / untracked cache settings (once per GitManager)
+    void EnsureFsmonitor();
+
+    // Add/update the mirrorN remotes and drop ones no longer configured
+    // (once per GitManager)
+    void EnsureMirrors();
+
+    // Id of <remote>/main as of the last fetch or push, or ""
+    std::string TrackingTip(const std::string& remote);
+
+    // Push main to every remote at once, each with its own timeout;
+    // records per-remote latency and health. True if origin accepted.
+    bool PushToRemotes(bool setUpstream);
+
+    // After a failed push: fetch origin and, if it has commits we lack,
+    // rebase onto them. True if there is something new to push.
+    bool CatchUpWithOrigin();
+
+    // Whether the last fetch/push against remote succeeded (or none was made)
+    static bool RemoteHealthy(const std::string& remote);
+
+    // Record one fetch/push against a remote for RankRemotes
+    static void RecordRemote(const std::string& remote, const char* op, double ms, bool ok);
+
+    // Initial commit of all synced files through one `git fast-import`
+    // stream instead of add -A + commit. Returns false to fall back.
+    bool BulkImportInitialCommit(const std::string& message);
 };
@@ -0,0 +1,113 @@
+#include "git_status.h"
+#include <cstdlib>
+
+// Skip n space-separated fields; returns the rest, or an empty view
+static std::string_view SkipFields(std::string_view rec, int n) {
+    while (n-- > 0) {
+        size_t sp = rec.find(' ');
+        if (sp == std::string_view::npos) return {};
+        rec.remove_prefix(sp + 1);
+    }
+    return rec;
+}
+
+static int ParseCount(std::string_view s) {
+    int n = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9') break;
+        n = n * 10 + (c - '0');
+    }
+    return n;
+}
+
+static void ParseHeader(std::string_view rec, ChangeSet& out) {
+    // "# branch.<key> <value>"
+    rec = SkipFields(rec, 1);
+    size_t sp = rec.find(' ');
+    if (sp == std::string_view::npos) return;
+    std::string_view key = rec.substr(0, sp), value = rec.substr(sp + 1);
+
+    if (key == "branch.head") {
+        out.head = value;
+    } else if (key == "branch.upstream") {
+        out.upstream = value;
+    } else if (key == "branch.ab") {
+        // "+<ahead> -<behind>"
+        size_t minus = value.find(" -");
+        if (value.size() < 2 || value[0] != '+' || minus == std::string_view::npos) return;
+        out.ahead = ParseCount(value.substr(1));
+        out.behind = ParseCount(value.substr(minus + 2));
+        out.hasAheadBehind = true;
+    }
+}
+
+namespace GitStatus {
+
+bool Parse(std::string&& output, ChangeSet& out) {
+    out.buffer = std::move(output);
+    out.entries.clear();
+    out.head = out.upstream = {};
+    out.hasAheadBehind = false;
+    out.ahead = out.behind = out.unmerged = out.untracked = 0;
+
+    std::string_view rest(out.buffer);
+    auto next = [&rest]() {
+        size_t nul = rest.find('\0');
+        std::string_view rec = rest.substr(0, nul);
+        rest.remove_prefix(nul == std::string_view::npos ? rest.size() : nul + 1);
+        return rec;
+    };
+
+    while (!rest.empty()) {
+        std::string_view rec = next();
+        if (rec.empty()) continue;
+
+        StatusEntry e;
+        switch (rec[0]) {
+        case '#':
+            ParseHeader(rec, out);
+            continue;
+        case '1':   // 1 XY sub mH mI mW hH hI path
+            e.kind = StatusEntry::Kind::Changed;
+            e.path = SkipFields(rec, 8);
+            break;
+        case '2':   // 2 XY sub mH mI mW hH hI Xscore path \0 origPath
+            e.kind = StatusEntry::Kind::Renamed;
+            e.path = SkipFields(rec, 9);
+            e.origPath = next();
+            break;
+        case 'u':   // u XY sub m1 m2 m3 mW h1 h2 h3 path
+            e.kind = StatusEntry::Kind::Unmerged;
+            e.path = SkipFields(rec, 10);
+            out.unmerged++;
+            break;
+        case '?':
+            e.kind = StatusEntry::Kind::Untracked;
+            e.path = SkipFields(rec, 1);
+            out.untracked++;
+            break;
+        case '!':
+            continue;       // ignored files are never synced
+        default:
+            return false;
+        }
+
+        if (e.path.empty()) return false;
+        if (e.kind != StatusEntry::Kind::Untracked) {
+            if (rec.size() < 4) return false;
+            e.index = rec[2];
+            e.worktree = rec[3];
+        } else {
+            e.worktree = '?';
+        }
+        out.entries.push_back(e);
+    }
+    return true;
+}
+
+std::string_view FileName(std::string_view path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace GitStatus
@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One entry of `git status --porcelain=v2 -z`. Views point into the owning
+// ChangeSet's buffer.
+struct StatusEntry {
+    enum class Kind { Changed, Renamed, Unmerged, Untracked, Ignored };
+    Kind kind = Kind::Changed;
+    char index = '.';               // X: staged state ('.' = unchanged)
+    char worktree = '.';            // Y: working tree state
+    std::string_view path;
+    std::string_view origPath;      // renames/copies only
+};
+
+// Parsed `git status --porcelain=v2 -z --branch`. Holds the raw output and
+// views into it, so parsing copies no path strings; not copyable or
+// movable, as that would leave the views dangling.
+struct ChangeSet {
+    ChangeSet() = default;
+    ChangeSet(const ChangeSet&) = delete;
+    ChangeSet& operator=(const ChangeSet&) = delete;
+
+    std::string buffer;
+    std::vector<StatusEntry> entries;
+
+    std::string_view head;          // branch name, "(detached)"
+    std::string_view upstream;      // empty if no upstream is configured
+    bool hasAheadBehind = false;    // only when the upstream exists
+    int ahead = 0;                  // local commits not on the upstream
+    int behind = 0;
+
+    int unmerged = 0;
+    int untracked = 0;
+
+    // Entries git would commit after `add -A` (everything but ignored)
+    int ChangedCount() const { return static_cast<int>(entries.size()); }
+
+    // A push is needed if there is something to commit, unpushed commits,
+    // or an upstream whose ref is gone. Without any upstream, only changes
+    // count (the repo was never pushed with -u).
+    bool NeedsPush() const {
+        return !entries.empty() || ahead > 0 || (!upstream.empty() && !hasAheadBehind);
+    }
+};
+
+namespace GitStatus {
+
+// Take ownership of output and parse it in place. Returns false on a
+// malformed record (out holds what parsed before it).
+bool Parse(std::string&& output, ChangeSet& out);
+
+// Path's file name, for short UI / commit message lists
+std::string_view FileName(std::string_view path);
+
+} // namespace GitStatus
@@ -0,0 +1,116 @@
+#include "git_trace2.h"
+#include <nlohmann/json.hpp>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using json = nlohmann::json;
+
+namespace GitTrace2 {
+
+enum class Bucket { None, Negotiation, Index };
+
+static Bucket ClassifyRegion(const std::string& category, const std::string& label) {
+    if (label.find("negotiat") != std::string::npos) return Bucket::Negotiation;
+    if (category == "fetch-pack" || category == "send-pack" || category == "pack-objects")
+        return Bucket::Negotiation;
+    if (category == "index") return Bucket::Index;
+    if (category == "status" && label == "untracked") return Bucket::Index;
+    return Bucket::None;
+}
+
+static bool IsNetworkChild(const std::string& childClass) {
+    return childClass.rfind("transport/", 0) == 0 ||
+           childClass.rfind("remote-", 0) == 0;
+}
+
+// Streaming state: events arrive in order, one per line
+struct ParseState {
+    Trace2Summary* out = nullptr;
+    std::map<std::string, std::string> childClass;  // "<sid>#<child_id>" -> class
+    std::map<std::string, int> openRegions;         // "<sid>/<thread>#<bucket>" -> depth
+    bool any = false;
+};
+
+static void HandleEvent(ParseState& st, const json& ev) {
+    std::string event = ev.value("event", "");
+    std::string sid   = ev.value("sid", "");
+    bool topLevel = sid.find('/') == std::string::npos;
+    st.any = true;
+
+    if (event == "cmd_name" && topLevel) {
+        st.out->command = ev.value("name", "");
+    } else if (event == "exit" && topLevel) {
+        st.out->totalMs = ev.value("t_abs", 0.0) * 1000.0;
+    } else if (event == "child_start") {
+        std::string key = sid + "#" + std::to_string(ev.value("child_id", -1));
+        st.childClass[key] = ev.value("child_class", "");
+        st.out->childProcesses++;
+    } else if (event == "child_exit") {
+        std::string key = sid + "#" + std::to_string(ev.value("child_id", -1));
+        double ms = ev.value("t_rel", 0.0) * 1000.0;
+        const std::string& cls = st.childClass[key];
+        if (cls == "hook")            st.out->hooksMs += ms;
+        else if (IsNetworkChild(cls)) st.out->networkMs += ms;
+    } else if (event == "region_enter" || event == "region_leave") {
+        Bucket b = ClassifyRegion(ev.value("category", ""), ev.value("label", ""));
+        if (b == Bucket::None) return;
+
+        // Only the outermost region of a bucket counts, so nested regions
+        // (e.g. index/refresh inside index/preload) aren't added twice
+        std::string key = sid + "/" + ev.value("thread", "") + "#" +
+                          std::to_string(static_cast<int>(b));
+        int& depth = st.openRegions[key];
+        if (event == "region_enter") {
+            depth++;
+            return;
+        }
+        if (depth > 0) depth--;
+        if (depth != 0) return;
+
+        double ms = ev.value("t_rel", 0.0) * 1000.0;
+        if (b == Bucket::Negotiation) st.out->negotiationMs += ms;
+        else                          st.out->indexMs += ms;
+    }
+}
+
+static bool ParseStream(std::istream& in, Trace2Summary& out) {
+    out = Trace2Summary();
+    ParseState st;
+    st.out = &out;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        try {
+            HandleEvent(st, json::parse(line));
+        } catch (...) {
+            // Partial last line or a newer event shape; skip it
+        }
+    }
+    out.valid = st.any;
+    return st.any;
+}
+
+bool ParseFile(const std::string& path, Trace2Summary& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+    return ParseStream(f, out);
+}
+
+bool ParseText(const std::string& text, Trace2Summary& out) {
+    std::istringstream in(text);
+    return ParseStream(in, out);
+}
+
+std::string Format(const Trace2Summary& s) {
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "git %s: %.0f ms (network %.0f, negotiation %.0f, index %.0f, hooks %.0f)",
+             s.command.empty() ? "?" : s.command.c_str(),
+             s.totalMs, s.networkMs, s.negotiationMs, s.indexMs, s.hooksMs);
+    return buf;
+}
+
+} // namespace GitTrace2
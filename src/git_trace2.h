@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+
+// Time attribution for one git invocation, read from its trace2 event
+// stream (GIT_TRACE2_EVENT). Child git processes (remote helpers, index-pack,
+// hooks) write to the same stream, so their time is included.
+// Categories can overlap: the parent waits on the network while negotiating.
+struct Trace2Summary {
+    std::string command;        // top-level cmd_name, e.g. "pull"
+    double totalMs = 0;         // wall time of the top-level git process
+    double networkMs = 0;       // transport children (remote-https, ssh, upload-pack)
+    double negotiationMs = 0;   // fetch/push negotiation and pack transfer regions
+    double indexMs = 0;         // index read/refresh/preload and untracked scans
+    double hooksMs = 0;         // hook child processes
+    int childProcesses = 0;
+    bool valid = false;         // at least one event was parsed
+};
+
+namespace GitTrace2 {
+
+// Parse a trace2 event file (one JSON object per line). Returns true if any
+// event was read; malformed lines are skipped.
+bool ParseFile(const std::string& path, Trace2Summary& out);
+
+// Same, for an in-memory event stream
+bool ParseText(const std::string& text, Trace2Summary& out);
+
+// One-line breakdown for the log, e.g.
+// "git pull: 2350 ms (network 2100, negotiation 120, index 15, hooks 0)"
+std::string Format(const Trace2Summary& s);
+
+} // namespace GitTrace2
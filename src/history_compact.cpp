@@ -0,0 +1,251 @@
+#include "history_compact.h"
+#include "trace.h"
+#include <cstdlib>
+#include <ctime>
+
+// fast-import builds the compacted chain here before it is pushed
+static const char* kWorkRef = "refs/ddobuildsync/compact";
+
+static std::string FirstLine(const std::string& s) {
+    size_t end = s.find_first_of("\r\n");
+    return s.substr(0, end);
+}
+
+// Commit or tree id of rev, or "" if it doesn't exist
+static std::string Resolve(GitManager& git, const std::string& rev) {
+    std::string output;
+    if (git.RunGitQuiet("rev-parse -q --verify " + rev, output) != 0) return "";
+    return FirstLine(output);
+}
+
+bool HistoryCompactor::ListCommits(const std::string& tip, std::vector<Commit>& out) {
+    // One record per commit (-z), fields split by \x1f; raw dates are what
+    // fast-import takes back
+    std::string log;
+    if (m_git.RunGitQuiet("log --first-parent --reverse -z --date=raw "
+                          "\"--format=%H%x1f%T%x1f%ct%x1f%an <%ae> %ad%x1f%cn <%ce> %cd%x1f%B\" " + tip,
+                          log) != 0) {
+        return false;
+    }
+
+    size_t pos = 0;
+    while (pos < log.size()) {
+        size_t end = log.find('\0', pos);
+        if (end == std::string::npos) end = log.size();
+        std::string record = log.substr(pos, end - pos);
+        pos = end + 1;
+
+        std::string fields[6];
+        size_t start = 0;
+        for (int i = 0; i < 5; ++i) {
+            size_t sep = record.find('\x1f', start);
+            if (sep == std::string::npos) return false;
+            fields[i] = record.substr(start, sep - start);
+            start = sep + 1;
+        }
+        fields[5] = record.substr(start);
+
+        Commit c;
+        c.id = fields[0];
+        c.tree = fields[1];
+        c.time = std::strtoll(fields[2].c_str(), nullptr, 10);
+        c.author = fields[3];
+        c.committer = fields[4];
+        c.message = fields[5];
+        out.push_back(std::move(c));
+    }
+    return !out.empty();
+}
+
+std::string HistoryCompactor::PeriodOf(int64_t t) const {
+    time_t when = static_cast<time_t>(t);
+    struct tm local;
+    if (localtime_s(&local, &when) != 0) return "";
+    if (m_weekly) {
+        when -= static_cast<time_t>((local.tm_wday + 6) % 7) * 86400;
+        if (localtime_s(&local, &when) != 0) return "";
+    }
+    char date[16];
+    strftime(date, sizeof(date), "%Y-%m-%d", &local);
+    return date;
+}
+
+std::string HistoryCompactor::Rewrite(const std::vector<Commit>& commits, size_t oldCount) {
+    std::string stream = std::string("reset ") + kWorkRef + "\n";
+    int mark = 0;
+
+    // Each commit takes its whole tree from an existing commit ("M 040000
+    // <tree> \"\"" replaces the root), so no blob is read or written
+    auto add = [&](const Commit& c, const std::string& message) {
+        stream += std::string("commit ") + kWorkRef + "\n";
+        stream += "mark :" + std::to_string(mark + 1) + "\n";
+        stream += "author " + c.author + "\n";
+        stream += "committer " + c.committer + "\n";
+        stream += "data " + std::to_string(message.size()) + "\n" + message + "\n";
+        if (mark > 0) stream += "from :" + std::to_string(mark) + "\n";
+        stream += "M 040000 " + c.tree + " \"\"\n\n";
+        ++mark;
+    };
+
+    size_t i = 0;
+    while (i < oldCount) {
+        std::string period = PeriodOf(commits[i].time);
+        size_t last = i;
+        while (last + 1 < oldCount && PeriodOf(commits[last + 1].time) == period) ++last;
+
+        size_t count = last - i + 1;
+        if (count == 1) {
+            add(commits[i], commits[i].message);
+        } else {
+            add(commits[last], std::string(m_weekly ? "Builds, week of " : "Builds as of ") + period +
+                               " (" + std::to_string(count) + " commits)\n");
+        }
+        i = last + 1;
+    }
+    // Merges on the first-parent chain keep their tree but not their
+    // second parent; the merged-in commits were part of the tree anyway
+    for (; i < commits.size(); ++i) add(commits[i], commits[i].message);
+
+    std::string output;
+    int rc = m_git.RunGitQuiet("fast-import --quiet --force", output, [&stream](const ProcessWriteFn& write) {
+        write(stream.data(), stream.size());
+    });
+    if (rc != 0) {
+        m_git.LogOutput(output);
+        return "";
+    }
+
+    std::string tip = Resolve(m_git, kWorkRef);
+    m_git.RunGitQuiet(std::string("update-ref -d ") + kWorkRef, output);
+    return tip;
+}
+
+bool HistoryCompactor::Run() {
+    m_squashed = 0;
+    m_archiveRef.clear();
+    if (!m_git.IsRepoInitialized()) {
+        m_git.LogOutput("Error: repository not initialized");
+        return false;
+    }
+
+    m_git.Recover();
+    Trace::Span span("compact", "sync");
+    std::string output;
+
+    // Squashing needs every commit; a shallow clone has only the recent ones
+    if (m_git.RunGitQuiet("rev-parse --is-shallow-repository", output) != 0 || FirstLine(output) != "false") {
+        m_git.LogOutput("History compaction needs the full history; skipped");
+        return false;
+    }
+
+    if (m_bundleSync ||
+        (m_git.RunGitQuiet("for-each-ref --count=1 refs/ddobuildsync/bundles/", output) == 0 && !output.empty())) {
+        m_git.LogOutput("History compaction skipped: bundle-folder peers can't follow a rewritten main");
+        return false;
+    }
+
+    ChangeSet changes;
+    if (!m_git.GetStatus(changes) || changes.NeedsPush()) {
+        m_git.LogOutput("History compaction skipped: local changes not pushed yet");
+        return false;
+    }
+
+    // Start from exactly what origin has; the lease below is against it
+    Trace::Span fetchStage("compact.fetch", "sync");
+    if (m_git.RunGit("fetch origin main", output, nullptr, m_git.RemoteTimeoutMs()) != 0) {
+        m_git.LogOutput("History compaction skipped: fetch from origin failed");
+        return false;
+    }
+    fetchStage.End();
+    std::string tip = Resolve(m_git, "refs/remotes/origin/main");
+    if (tip.empty()) return false;
+    if (m_git.HeadCommit() != tip && m_git.RunGit("merge --ff-only origin/main", output) != 0) {
+        m_git.LogOutput("History compaction skipped: main has diverged from origin");
+        return false;
+    }
+
+    std::vector<Commit> commits;
+    if (!ListCommits(tip, commits)) {
+        m_git.LogOutput("History compaction failed: could not list commits");
+        return false;
+    }
+
+    // The old part is the run of commits from the root up to the cutoff
+    int64_t cutoff = static_cast<int64_t>(time(nullptr)) - static_cast<int64_t>(m_ageDays) * 86400;
+    size_t oldCount = 0;
+    while (oldCount < commits.size() && commits[oldCount].time < cutoff) ++oldCount;
+    // Rewrite() squashes each run of commits in the same period
+    size_t runs = 0;
+    std::string period;
+    for (size_t i = 0; i < oldCount; ++i) {
+        std::string p = PeriodOf(commits[i].time);
+        if (i == 0 || p != period) ++runs;
+        period = p;
+    }
+    int squashed = static_cast<int>(oldCount - runs);
+    if (squashed <= 0) {
+        m_git.LogOutput("History compaction: nothing older than " + std::to_string(m_ageDays) + " days to squash");
+        return true;
+    }
+
+    Trace::Span rewriteStage("compact.rewrite", "sync");
+    std::string newTip = Rewrite(commits, oldCount);
+    rewriteStage.End();
+    // The builds at the tip must come out exactly as they went in
+    if (newTip.empty() || Resolve(m_git, newTip + "^{tree}") != commits.back().tree) {
+        m_git.LogOutput("History compaction failed: rewrite did not reproduce main");
+        return false;
+    }
+
+    char stamp[32] = "";
+    time_t now = time(nullptr);
+    struct tm local;
+    if (localtime_s(&local, &now) == 0) strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+    m_archiveRef = std::string("refs/archive/main-") + stamp;
+
+    OpJournal& journal = m_git.Journal();
+    journal.Begin("compact", tip);
+    journal.Current().after = newTip;
+    journal.Current().remote = "origin";
+
+    // The originals go up first, so a failure past this point loses nothing
+    journal.Stage("archive");
+    m_git.RunGitQuiet("update-ref " + m_archiveRef + " " + tip, output);
+    if (m_git.RunGit("push origin " + tip + ":" + m_archiveRef, output, nullptr, m_git.RemoteTimeoutMs()) != 0) {
+        journal.End("failed");
+        m_git.LogOutput("History compaction failed: could not push " + m_archiveRef);
+        return false;
+    }
+
+    // Refused if anyone pushed since the fetch; their commits aren't in newTip
+    journal.Stage("upload");
+    if (m_git.RunGit("push --force-with-lease=main:" + tip + " origin " + newTip + ":main", output,
+                     nullptr, m_git.RemoteTimeoutMs()) != 0) {
+        journal.End("failed");
+        m_git.LogOutput("History compaction gave up: main changed on origin meanwhile (will retry later)");
+        return false;
+    }
+
+    // Same tree as before, so no build file changes
+    journal.Stage("reset");
+    m_git.RunGit("reset --keep " + newTip, output);
+    journal.End("ok");
+    m_git.MarkUpstream(newTip);
+
+    // Mirrors hold the same main as origin; each is leased against it too
+    for (const auto& remote : m_git.RemoteNames()) {
+        if (remote == "origin") continue;
+        bool ok = m_git.RunGit("push " + remote + " " + tip + ":" + m_archiveRef, output, nullptr,
+                               m_git.RemoteTimeoutMs()) == 0 &&
+                  m_git.RunGit("push --force-with-lease=main:" + tip + " " + remote + " " + newTip + ":main",
+                               output, nullptr, m_git.RemoteTimeoutMs()) == 0;
+        if (!ok) m_git.LogOutput("Mirror " + remote + " still has the uncompacted main; push it by hand");
+    }
+
+    m_git.History().Update();
+    m_squashed = squashed;
+    m_git.LogOutput("History compacted: " + std::to_string(oldCount) + " commits older than " +
+                    std::to_string(m_ageDays) + " days squashed into " + std::to_string(runs) +
+                    "; originals kept on " + m_archiveRef);
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "git_manager.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Squashes main's old history: every first-parent commit older than the
+// cutoff is folded into one commit per day or week (the tree of the last
+// commit in that period, with its author and dates), and the newer commits
+// are replayed unchanged on top. Builds at each period's end stay reachable
+// on main; the hourly steps in between don't, so a fresh clone fetches far
+// fewer objects.
+//
+// The old main is pushed to refs/archive/main-<time> first (clones don't
+// fetch refs/archive/*), then main is replaced with --force-with-lease
+// against the tip compaction started from, so a push from another machine
+// in between makes compaction give up instead of losing that push. Other
+// machines notice the rewrite on their next pull (see GitManager::Pull).
+class HistoryCompactor {
+public:
+    explicit HistoryCompactor(GitManager& git) : m_git(git) {}
+
+    void SetAgeDays(int days) { m_ageDays = days; }
+    void SetWeekly(bool weekly) { m_weekly = weekly; }
+
+    // Peers syncing through a bundle folder only ever merge, so they can't
+    // follow a rewritten main; Run() refuses while bundle sync is in use
+    // (configured here, or bundles imported into this repo before)
+    void SetBundleSync(bool enabled) { m_bundleSync = enabled; }
+
+    // Needs a clean work dir in step with origin and full history. True if
+    // main was compacted or there was nothing to compact.
+    bool Run();
+
+    // Commits squashed by the last Run(), and the archive ref it pushed
+    int Squashed() const { return m_squashed; }
+    const std::string& ArchiveRef() const { return m_archiveRef; }
+
+private:
+    struct Commit {
+        std::string id;
+        std::string tree;
+        int64_t time = 0;       // committer time
+        std::string author;     // "Name <email> <time> <tz>", as fast-import wants it
+        std::string committer;
+        std::string message;
+    };
+
+    GitManager& m_git;
+    int m_ageDays = 90;
+    bool m_weekly = true;
+    bool m_bundleSync = false;
+    int m_squashed = 0;
+    std::string m_archiveRef;
+
+    // main's first-parent chain up to tip, oldest first
+    bool ListCommits(const std::string& tip, std::vector<Commit>& out);
+
+    // Local date of the day or week (its Monday) t falls in, "YYYY-MM-DD"
+    std::string PeriodOf(int64_t t) const;
+
+    // Write the compacted chain with one fast-import; new tip or ""
+    std::string Rewrite(const std::vector<Commit>& commits, size_t oldCount);
+};
@@ -0,0 +1,281 @@
+#include "history_index.h"
+#include "git_manager.h"
+#include "git_status.h"
+#include "trace.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <tuple>
+
+// 2: merges record their effect on main
+static const int kIndexVersion = 2;
+
+static bool EqualsNoCase(const std::string& a, std::string_view b) {
+    return a.size() == b.size() && _strnicmp(a.data(), b.data(), a.size()) == 0;
+}
+
+void HistoryIndex::SetWorkDir(const std::string& workDir) {
+    if (workDir == m_workDir) return;
+    m_workDir = workDir;
+    Clear();
+    m_loaded = false;
+}
+
+std::string HistoryIndex::Path() const {
+    return m_workDir + "\\.git\\ddobuildsync_history.idx";
+}
+
+void HistoryIndex::Clear() {
+    m_tip.clear();
+    m_shallow = false;
+    m_version = 0;
+    m_commits.clear();
+    m_byPath.clear();
+}
+
+void HistoryIndex::Load() {
+    m_loaded = true;
+    Clear();
+    std::ifstream f(Path(), std::ios::binary);
+    if (!f.is_open()) return;
+
+    // Records after the last "t" are from an update that didn't finish
+    size_t committedCommits = 0;
+    std::vector<std::pair<std::string, Change>> pending;
+    bool torn = false;
+
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.size() < 3 || line[1] != ' ') continue;
+        const char* rest = line.c_str() + 2;
+        switch (line[0]) {
+        case 'v':
+            m_version = std::atoi(rest);
+            break;
+        case 's':
+            m_shallow = rest[0] == '1';
+            break;
+        case 'c': {
+            const char* space = strchr(rest, ' ');
+            if (!space) break;
+            m_commits.push_back({std::string(rest, space), std::strtoll(space + 1, nullptr, 10)});
+            torn = true;
+            break;
+        }
+        case 'e':
+            if (m_commits.empty() || line.size() < 5) break;
+            pending.push_back({line.substr(4), {static_cast<uint32_t>(m_commits.size() - 1), line[2]}});
+            break;
+        case 't':
+            for (auto& p : pending) m_byPath[p.first].push_back(p.second);
+            pending.clear();
+            committedCommits = m_commits.size();
+            m_tip = rest;
+            torn = false;
+            break;
+        }
+    }
+    m_commits.resize(committedCommits);
+
+    // Drop the partial update from the file too, so the next append
+    // doesn't land after it
+    if (torn) Rewrite();
+}
+
+bool HistoryIndex::Rewrite() {
+    std::vector<std::tuple<uint32_t, char, const std::string*>> changes;
+    for (const auto& p : m_byPath) {
+        for (const auto& c : p.second) changes.emplace_back(c.commit, c.status, &p.first);
+    }
+    std::stable_sort(changes.begin(), changes.end(), [](const auto& a, const auto& b) {
+        return std::get<0>(a) < std::get<0>(b);
+    });
+
+    std::string text = "v " + std::to_string(m_version) + "\n";
+    text += std::string("s ") + (m_shallow ? "1" : "0") + "\n";
+    size_t next = 0;
+    for (uint32_t i = 0; i < m_commits.size(); ++i) {
+        text += "c " + m_commits[i].id + " " + std::to_string(m_commits[i].time) + "\n";
+        for (; next < changes.size() && std::get<0>(changes[next]) == i; ++next) {
+            text += std::string("e ") + std::get<1>(changes[next]) + " " + *std::get<2>(changes[next]) + "\n";
+        }
+    }
+    if (!m_tip.empty()) text += "t " + m_tip + "\n";
+
+    std::string tmp = Path() + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f.is_open()) return false;
+        f << text;
+        if (!f.good()) return false;
+    }
+    return MoveFileExA(tmp.c_str(), Path().c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool HistoryIndex::Append(const std::string& text) {
+    std::ofstream f(Path(), std::ios::binary | std::ios::app);
+    if (!f.is_open()) return false;
+    f << text;
+    return f.good();
+}
+
+std::string HistoryIndex::AddLog(const std::string& log) {
+    // "\x01<commit> <time>\0" then "\n<status>\0<path>\0" pairs; a merge
+    // lists what it changed against its first parent (main before it)
+    std::string records;
+    char status = 0;
+    size_t pos = 0;
+    while (pos < log.size()) {
+        size_t end = log.find('\0', pos);
+        if (end == std::string::npos) end = log.size();
+        std::string_view token(log.data() + pos, end - pos);
+        pos = end + 1;
+        if (!token.empty() && token[0] == '\n') token.remove_prefix(1);
+        if (token.empty()) continue;
+
+        if (token[0] == '\x01') {
+            size_t space = token.find(' ');
+            if (space == std::string_view::npos) continue;
+            Commit c;
+            c.id = std::string(token.substr(1, space - 1));
+            c.time = std::strtoll(std::string(token.substr(space + 1)).c_str(), nullptr, 10);
+            records += "c " + c.id + " " + std::to_string(c.time) + "\n";
+            m_commits.push_back(std::move(c));
+            status = 0;
+        } else if (status == 0) {
+            status = token[0];
+        } else {
+            std::string path(token);
+            if (!m_commits.empty() && path.find('\n') == std::string::npos) {
+                char s = (status == 'A' || status == 'D') ? status : 'M';
+                m_byPath[path].push_back({static_cast<uint32_t>(m_commits.size() - 1), s});
+                records += std::string("e ") + s + " " + path + "\n";
+            }
+            status = 0;
+        }
+    }
+    return records;
+}
+
+bool HistoryIndex::Update() {
+    if (!m_loaded) Load();
+
+    std::string head = m_git.HeadCommit();
+    if (head.empty() || head == m_tip) return true;
+
+    // A shallow clone that has since fetched its history has older commits
+    // the index never saw
+    bool shallowNow = Utils::FileExists(m_workDir + "\\.git\\shallow");
+    bool rebuild = m_tip.empty() || (m_shallow && !shallowNow) || m_version < kIndexVersion;
+    std::string output;
+    if (!rebuild && m_git.RunGitQuiet("merge-base --is-ancestor " + m_tip + " " + head, output) != 0) {
+        rebuild = true;
+    }
+
+    Trace::Span span("history.update", "sync", rebuild ? "rebuild" : "incremental");
+    if (rebuild) {
+        m_git.LogOutput("Indexing build history...");
+        Clear();
+        m_version = kIndexVersion;
+    }
+
+    std::string range = rebuild ? head : m_tip + ".." + head;
+    std::string log;
+    if (m_git.RunGitQuiet("log --reverse --no-renames --diff-merges=first-parent --name-status -z --format=%x01%H%x20%ct " + range, log) != 0) {
+        m_git.LogOutput("Updating build history index failed");
+        if (rebuild) m_loaded = false;    // reload what's on disk next time
+        return false;
+    }
+
+    std::string records = AddLog(log);
+    m_tip = head;
+    if (rebuild) {
+        m_shallow = shallowNow;
+        return Rewrite();
+    }
+    return Append(records + "t " + head + "\n");
+}
+
+std::string HistoryIndex::Resolve(const std::string& path) {
+    if (!m_loaded) Load();
+
+    std::string key = path;
+    std::replace(key.begin(), key.end(), '\\', '/');
+    if (m_byPath.count(key)) return key;
+
+    // Windows paths are case-insensitive; a bare name may be in a subfolder
+    bool bareName = key.find('/') == std::string::npos;
+    for (const auto& p : m_byPath) {
+        if (EqualsNoCase(key, p.first) || (bareName && EqualsNoCase(key, GitStatus::FileName(p.first)))) {
+            return p.first;
+        }
+    }
+    return "";
+}
+
+std::vector<HistoryEntry> HistoryIndex::History(const std::string& path) {
+    std::vector<HistoryEntry> out;
+    auto it = m_byPath.find(Resolve(path));
+    if (it == m_byPath.end()) return out;
+
+    for (auto c = it->second.rbegin(); c != it->second.rend(); ++c) {
+        HistoryEntry e;
+        e.commit = m_commits[c->commit].id;
+        e.time = m_commits[c->commit].time;
+        e.status = c->status;
+        out.push_back(std::move(e));
+    }
+    return out;
+}
+
+bool HistoryIndex::VersionAt(const std::string& path, int64_t time, HistoryEntry& out) {
+    auto it = m_byPath.find(Resolve(path));
+    if (it == m_byPath.end()) return false;
+
+    // Commits from several machines interleave, so go by time, not order
+    const Change* best = nullptr;
+    for (const auto& c : it->second) {
+        int64_t t = m_commits[c.commit].time;
+        if (t <= time && (!best || t >= m_commits[best->commit].time)) best = &c;
+    }
+    if (!best || best->status == 'D') return false;
+
+    out.commit = m_commits[best->commit].id;
+    out.time = m_commits[best->commit].time;
+    out.status = best->status;
+    return true;
+}
+
+bool HistoryIndex::Restore(const std::string& path, double days) {
+    std::string stored = Resolve(path);
+    if (stored.empty()) {
+        m_git.LogOutput("No history for " + path);
+        return false;
+    }
+
+    int64_t when = static_cast<int64_t>(time(nullptr)) - static_cast<int64_t>(days * 86400.0);
+    HistoryEntry version;
+    if (!VersionAt(stored, when, version)) {
+        char ago[32];
+        snprintf(ago, sizeof(ago), "%g", days);
+        m_git.LogOutput(stored + " did not exist " + ago + " day(s) ago");
+        return false;
+    }
+
+    std::string output;
+    if (m_git.RunGit("checkout " + version.commit + " -- \"" + stored + "\"", output) != 0) {
+        m_git.LogOutput("Restoring " + stored + " failed");
+        return false;
+    }
+
+    char stamp[32] = "";
+    time_t t = static_cast<time_t>(version.time);
+    struct tm local;
+    if (localtime_s(&local, &t) == 0) strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M", &local);
+    m_git.LogOutput("Restored " + stored + " as of " + stamp + " (" + version.commit.substr(0, 8) + ")");
+    return true;
+}
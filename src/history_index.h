@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class GitManager;
+
+struct HistoryEntry {
+    std::string commit;
+    int64_t time = 0;       // committer time, seconds since 1970 (UTC)
+    char status = 'M';      // 'A'dded, 'M'odified or 'D'eleted in this commit
+};
+
+// Which commits touched which build, so one build's history never needs
+// `git log -- <file>` (a walk of every commit). Kept in
+// .git\ddobuildsync_history.idx, append-only:
+//
+//   v <n>                   format version; an older index is rebuilt
+//   s <0|1>                 whether the repo was shallow when indexing began
+//   c <commit> <time>       a commit, in the order git log --reverse gave it
+//   e <status> <path>       a path that commit added/modified/deleted (for a
+//                           merge: what it changed on main, its first parent)
+//   t <commit>              everything up to this commit is indexed
+//
+// Update() appends the commits between the last "t" and HEAD from one
+// `git log --name-status`; a HEAD that no longer contains the last "t"
+// (history rewritten) or a shallow repo that got its history rebuilds it.
+class HistoryIndex {
+public:
+    explicit HistoryIndex(GitManager& git) : m_git(git) {}
+
+    void SetWorkDir(const std::string& workDir);
+
+    // Bring the index up to HEAD. False if git failed (the index is kept).
+    bool Update();
+
+    // Commits that touched path ('/'-separated, relative to the work dir),
+    // newest first. A bare file name also matches a build in a subfolder.
+    std::vector<HistoryEntry> History(const std::string& path);
+
+    // The version of path as of time: the last commit at or before it that
+    // added or modified it. False if it didn't exist then.
+    bool VersionAt(const std::string& path, int64_t time, HistoryEntry& out);
+
+    // Put the version of path from `days` ago into the work dir (the next
+    // push commits it). False if there was no such version.
+    bool Restore(const std::string& path, double days);
+
+    // Path as stored in the index, or "" if no commit ever touched it
+    std::string Resolve(const std::string& path);
+
+private:
+    struct Change {
+        uint32_t commit;    // index into m_commits
+        char status;
+    };
+    struct Commit {
+        std::string id;
+        int64_t time;
+    };
+
+    GitManager& m_git;
+    std::string m_workDir;
+    bool m_loaded = false;
+    std::string m_tip;
+    bool m_shallow = false;         // indexed while .git\shallow existed
+    int m_version = 0;              // format the file was indexed in
+    std::vector<Commit> m_commits;
+    std::unordered_map<std::string, std::vector<Change>> m_byPath;
+
+    std::string Path() const;
+    void Load();
+    void Clear();
+    bool Rewrite();
+    bool Append(const std::string& text);
+
+    // Parse `git log --name-status -z` output into the index; returns the
+    // same records in file form
+    std::string AddLog(const std::string& log);
+};
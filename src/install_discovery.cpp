@@ -0,0 +1,186 @@
+#include "install_discovery.h"
+#include "trace.h"
+#include "updater.h"
+#include "utils.h"
+#include <nlohmann/json.hpp>
+#include <shlobj.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using json = nlohmann::json;
+
+// Root, its children and grandchildren: deep enough for Documents\Games\DDOBuilderV2_x
+static const int kMaxDepth = 2;
+
+// Everything one walk of a root saw; enough to tell later whether it changed
+struct RootScan {
+    std::map<std::string, uint64_t> dirMtimes;    // every directory listed
+    std::vector<InstallCandidate> installs;
+};
+
+static uint64_t DirMtime(const std::string& path) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) return 0;
+    return (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+           data.ftLastWriteTime.dwLowDateTime;
+}
+
+static bool StartsWithNoCase(const char* name, const char* prefix) {
+    return _strnicmp(name, prefix, strlen(prefix)) == 0;
+}
+
+static void Walk(const std::string& dir, int depth, RootScan& scan) {
+    scan.dirMtimes[dir] = DirMtime(dir);
+
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileExA((dir + "\\*").c_str(), FindExInfoBasic, &fd,
+                                FindExSearchLimitToDirectories, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (h == INVALID_HANDLE_VALUE) return;
+    do {
+        if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) continue;
+        // Junctions (e.g. "My Music" in old profiles) loop or leave the root
+        if (fd.dwFileAttributes & (FILE_ATTRIBUTE_REPARSE_POINT | FILE_ATTRIBUTE_HIDDEN)) continue;
+        if (fd.cFileName[0] == '.') continue;
+
+        std::string path = dir + "\\" + fd.cFileName;
+        if (StartsWithNoCase(fd.cFileName, "DDOBuilder")) {
+            InstallCandidate c;
+            c.folder = path;
+            c.version = Updater::ExtractVersionFromPath(fd.cFileName);
+            c.hasExe = Utils::FileExists(path + "\\DDOBuilder.exe");
+            // Adding or removing the exe changes this folder's mtime
+            scan.dirMtimes[path] = DirMtime(path);
+            scan.installs.push_back(c);
+        } else if (depth < kMaxDepth) {
+            Walk(path, depth + 1, scan);
+        }
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+}
+
+static std::string CachePath() {
+    return Utils::GetExeDir() + "\\ddobuildsync_installs.json";
+}
+
+static std::map<std::string, RootScan> LoadCache() {
+    std::map<std::string, RootScan> cache;
+    std::ifstream f(CachePath());
+    if (!f.is_open()) return cache;
+
+    try {
+        json j = json::parse(f);
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            RootScan scan;
+            scan.dirMtimes = it.value()["dirs"].get<std::map<std::string, uint64_t>>();
+            for (const auto& c : it.value()["installs"]) {
+                InstallCandidate ic;
+                ic.folder  = c.value("folder", "");
+                ic.version = c.value("version", "");
+                ic.hasExe  = c.value("hasExe", false);
+                scan.installs.push_back(ic);
+            }
+            cache[it.key()] = std::move(scan);
+        }
+    } catch (...) {
+        cache.clear();
+    }
+    return cache;
+}
+
+static void SaveCache(const std::map<std::string, RootScan>& cache) {
+    json j = json::object();
+    for (const auto& r : cache) {
+        json installs = json::array();
+        for (const auto& c : r.second.installs) {
+            installs.push_back({{"folder", c.folder}, {"version", c.version}, {"hasExe", c.hasExe}});
+        }
+        j[r.first] = {{"dirs", r.second.dirMtimes}, {"installs", installs}};
+    }
+    std::ofstream f(CachePath());
+    if (f.is_open()) f << j.dump(1);
+}
+
+static bool CacheValid(const RootScan& scan) {
+    for (const auto& d : scan.dirMtimes) {
+        if (DirMtime(d.first) != d.second) return false;
+    }
+    return !scan.dirMtimes.empty();
+}
+
+namespace InstallDiscovery {
+
+std::vector<std::string> DefaultRoots() {
+    std::vector<std::string> roots;
+    const int folders[] = {CSIDL_PERSONAL, CSIDL_DESKTOPDIRECTORY, CSIDL_PROGRAM_FILES, CSIDL_PROGRAM_FILESX86};
+    char path[MAX_PATH];
+    for (int csidl : folders) {
+        if (SUCCEEDED(SHGetFolderPathA(nullptr, csidl, nullptr, 0, path))) roots.push_back(path);
+    }
+    // No CSIDL for Downloads; it sits next to Documents in the profile
+    if (SUCCEEDED(SHGetFolderPathA(nullptr, CSIDL_PROFILE, nullptr, 0, path))) {
+        roots.push_back(std::string(path) + "\\Downloads");
+    }
+    return roots;
+}
+
+std::vector<InstallCandidate> Discover(const std::vector<std::string>& extraRoots) {
+    Trace::Span span("install.discover", "startup");
+
+    std::vector<std::string> roots = DefaultRoots();
+    for (const auto& r : extraRoots) {
+        if (std::find(roots.begin(), roots.end(), r) == roots.end()) roots.push_back(r);
+    }
+    // Program Files (x86) is Program Files on 32-bit Windows
+    roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+
+    std::map<std::string, RootScan> cache = LoadCache();
+    std::map<std::string, RootScan> fresh;
+    std::mutex freshMutex;
+    bool changed = false;
+
+    std::vector<std::thread> threads;
+    for (const auto& root : roots) {
+        auto it = cache.find(root);
+        if (it != cache.end() && CacheValid(it->second)) {
+            // Walkers for earlier roots are already inserting
+            std::lock_guard<std::mutex> lock(freshMutex);
+            fresh[root] = it->second;
+            continue;
+        }
+        if (!Utils::DirExists(root)) {
+            if (it != cache.end()) changed = true;
+            continue;
+        }
+        changed = true;
+        threads.emplace_back([root, &fresh, &freshMutex]() {
+            RootScan scan;
+            Walk(root, 0, scan);
+            std::lock_guard<std::mutex> lock(freshMutex);
+            fresh[root] = std::move(scan);
+        });
+    }
+    for (auto& t : threads) t.join();
+    if (changed) SaveCache(fresh);
+
+    std::vector<InstallCandidate> all;
+    for (const auto& r : fresh) {
+        for (const auto& c : r.second.installs) {
+            bool dup = std::any_of(all.begin(), all.end(),
+                                   [&c](const InstallCandidate& a) { return _stricmp(a.folder.c_str(), c.folder.c_str()) == 0; });
+            if (!dup) all.push_back(c);
+        }
+    }
+
+    std::stable_sort(all.begin(), all.end(), [](const InstallCandidate& a, const InstallCandidate& b) {
+        if (a.hasExe != b.hasExe) return a.hasExe;
+        if (a.version.empty() != b.version.empty()) return !a.version.empty();
+        return Updater::IsNewer(a.version, b.version);
+    });
+    return all;
+}
+
+} // namespace InstallDiscovery
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct InstallCandidate {
+    std::string folder;
+    std::string version;        // from the folder name (DDOBuilderV2_x.y.z.w), "" if none
+    bool hasExe = false;        // DDOBuilder.exe present
+};
+
+// Finds DDO Builder installs (folders named DDOBuilder*) below a set of
+// roots. Each root is walked on its own thread, at most kMaxDepth levels
+// deep. Results are cached per root in ddobuildsync_installs.json with the
+// mtime of every directory visited; a root whose directories are all
+// unchanged is answered from the cache without listing anything.
+namespace InstallDiscovery {
+
+// Documents, Desktop, Downloads, Program Files, Program Files (x86)
+std::vector<std::string> DefaultRoots();
+
+// All installs below DefaultRoots() and extraRoots, best first: with
+// DDOBuilder.exe before without, then newest version
+std::vector<InstallCandidate> Discover(const std::vector<std::string>& extraRoots = {});
+
+} // namespace InstallDiscovery
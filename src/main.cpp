@@ -2,12 +2,32 @@
 #include <windows.h>
 #include <objbase.h>
 #include <commctrl.h>
+#include <shellapi.h>
+#include "command_channel.h"
 #include "main_window.h"
+#include "utils.h"
 
 #pragma comment(lib, "comctl32.lib")
 #pragma comment(linker, "/manifestdependency:\"type='win32' name='Microsoft.Windows.Common-Controls' version='6.0.0.0' processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int) {
+    // DDOBuildSync.exe [show|launch|pull|push], e.g. from a shortcut
+    std::string command = "show";
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (argv) {
+        if (argc > 1) command = Utils::ToUtf8(argv[1]);
+        LocalFree(argv);
+    }
+
+    // Already running: hand it the command (it may come to the front)
+    if (!CommandChannel::ClaimInstance()) {
+        AllowSetForegroundWindow(ASFW_ANY);
+        std::string reply;
+        CommandChannel::Send(command, reply);
+        return 0;
+    }
+
     // Initialize COM (needed for SHBrowseForFolder)
     CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
 
@@ -23,6 +43,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int) {
         CoUninitialize();
         return 1;
     }
+    if (command != "show") mainWindow.RunCommand(command);
 
     // Message loop
     MSG msg;
@@ -1,12 +1,35 @@
 #include "main_window.h"
+#include "build_diff.h"
+#include "bundle_sync.h"
+#include "history_compact.h"
+#include "install_discovery.h"
 #include "utils.h"
+#include "trace.h"
+#include "metrics.h"
+#include "process.h"
+#include <nlohmann/json.hpp>
 #include <commdlg.h>
 #include <shlobj.h>
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+using json = nlohmann::json;
 
 static const wchar_t* CLASS_NAME = L"DDOBuildSyncWindow";
 static const wchar_t* WINDOW_TITLE = L"DDO Build Sync";
 
+// Per build in the log after a pull; the rest are counted
+static const size_t kMaxChangesShown = 8;
+
+// How long a channel client waits on a UI thread stuck in a dialog
+static const auto kCommandTimeout = std::chrono::seconds(3);
+
+// History compaction is tried at most this often by the background sync
+static const uint64_t kCompactIntervalMs = 24ull * 60 * 60 * 1000;
+
 static MainWindow* GetThis(HWND hwnd) {
     return reinterpret_cast<MainWindow*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
 }
@@ -42,6 +65,7 @@ LRESULT MainWindow::HandleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
     }
     case WM_APP_GIT_DONE:
         m_busy = false;
+        m_stateStale = true;
         EnableWindow(m_btnLaunch, TRUE);
         EnableWindow(m_btnPull,   TRUE);
         EnableWindow(m_btnPush,   TRUE);
@@ -58,18 +82,54 @@ LRESULT MainWindow::HandleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
             OnPush();
         }
         return 0;
+    case WM_APP_EXE_UPDATED: {
+        char* exe = reinterpret_cast<char*>(lParam);
+        if (exe) {
+            m_configMgr.Get().ddoBuilderExe = exe;
+            m_configMgr.Commit();
+            free(exe);
+        }
+        return 0;
+    }
+    case WM_APP_PROBE_DONE:
+        OnProbeDone(reinterpret_cast<StateSnapshot*>(lParam));
+        return 0;
+    case WM_APP_SYNC_DONE:
+        OnSyncDone(reinterpret_cast<SyncOutcome*>(lParam));
+        return 0;
+    case WM_APP_LOCAL_EDIT:
+        if (m_scheduler.NoteLocalEdit(GetTickCount64())) ArmSyncTimer();
+        return 0;
+    case WM_APP_COMMAND: {
+        auto* request = reinterpret_cast<RemoteCommand*>(lParam);
+        if (!request) return 0;
+        // A status from before the last sync or edit would be wrong; probe
+        // again and answer when it's done
+        if (request->command == "status" && m_stateStale) {
+            m_statusWaiters.emplace_back(request);
+            StartProbe();
+            return 0;
+        }
+        request->reply.set_value(RunCommand(request->command));
+        delete request;
+        return 0;
+    }
     case WM_TIMER:
-        if (wParam == IDT_SYNC_INITIAL) {
-            KillTimer(m_hwnd, IDT_SYNC_INITIAL);
-            SetTimer(m_hwnd, IDT_SYNC_HOUR, 3600000, nullptr);
+        if (wParam == IDT_PROFILES) {
+            m_profiles.Tick();
+            return 0;
+        }
+        if (wParam == IDT_SYNC) {
+            KillTimer(m_hwnd, IDT_SYNC);
+            OnSyncTimer();
         }
-        OnSyncTimer();
         return 0;
     case WM_CLOSE:
-        KillTimer(m_hwnd, IDT_SYNC_INITIAL);
-        KillTimer(m_hwnd, IDT_SYNC_HOUR);
+        KillTimer(m_hwnd, IDT_SYNC);
+        KillTimer(m_hwnd, IDT_PROFILES);
         if (m_workerThread.joinable()) m_workerThread.detach();
         if (m_monitorThread.joinable()) m_monitorThread.detach();
+        if (m_probeThread.joinable()) m_probeThread.detach();
         OnDestroy();
         return 0;
     case WM_DESTROY:
@@ -113,14 +173,22 @@ void MainWindow::OnCreate() {
     // Load config
     m_configMgr.LoadDefault();
     auto& cfg = m_configMgr.Get();
+    Trace::SetEnabled(cfg.traceEnabled);
+    Trace::Span span("ui.OnCreate", "ui");
+    Metrics::LoadFile(Metrics::DefaultPath());
 
     // Auto-detect DDO Builder if not configured
     if (cfg.buildsFolder.empty()) {
-        std::string detected = Utils::AutoDetectDDOBuilderFolder();
-        if (!detected.empty()) {
+        auto installs = InstallDiscovery::Discover(cfg.installSearchRoots);
+        if (!installs.empty()) {
+            const std::string& detected = installs.front().folder;
             cfg.buildsFolder = detected;
             cfg.ddoBuilderExe = detected + "\\DDOBuilder.exe";
             AppendLog("Auto-detected DDO Builder at: " + detected);
+            if (installs.size() > 1) {
+                AppendLog("  (newest of " + std::to_string(installs.size()) + " installs found)");
+            }
+            m_configMgr.Commit();
         }
     }
 
@@ -134,6 +202,16 @@ void MainWindow::OnCreate() {
     // Setup git manager
     m_gitMgr.SetWorkDir(cfg.buildsFolder);
     m_gitMgr.SetRepoUrl(cfg.gitRepoUrl);
+    m_gitMgr.SetMirrorUrls(cfg.mirrorUrls);
+    m_gitMgr.SetRemoteTimeoutMs(cfg.remoteTimeoutSec * 1000);
+    m_gitMgr.SetTrace2Enabled(cfg.gitTrace2Enabled);
+    CanonicalOptions canon;
+    canon.unorderedElements.insert(cfg.canonicalUnorderedElements.begin(),
+                                   cfg.canonicalUnorderedElements.end());
+    m_gitMgr.SetCanonicalize(cfg.canonicalizeBuilds, canon);
+    m_gitMgr.SetSyncRules(SyncRules::FromConfig(cfg));
+    m_gitMgr.SetFsmonitor(cfg.fsmonitorEnabled);
+    m_gitMgr.SetMergeBuilds(cfg.mergeBuilds);
     m_gitMgr.SetLogCallback([this](const std::string& msg) {
         // Post to UI thread
         char* copy = _strdup(msg.c_str());
@@ -149,29 +227,37 @@ void MainWindow::OnCreate() {
         AppendLog("First run detected - click Setup to configure");
         SetStatus(L"Setup required");
     } else {
-        // Check git status
-        if (!m_gitMgr.IsGitAvailable()) {
-            AppendLog("WARNING: git not found on PATH. Install git and restart.");
-            SetStatus(L"Git not found");
-        } else if (!m_gitMgr.IsRepoInitialized()) {
-            AppendLog("Git repo not initialized in builds folder. Click Setup to initialize.");
-            SetStatus(L"Repo not initialized");
+        // Paint the last known state right away; git probes run in the background
+        StateSnapshot cached;
+        if (StateCache::Load(cached) && cached.buildsFolder == cfg.buildsFolder) {
+            ShowState(cached, true);
+            m_state = cached;
         } else {
-            SetStatus(L"Ready");
-            int changed = m_gitMgr.GetChangedFileCount();
-            if (changed > 0) {
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%d changed file(s) detected", changed);
-                AppendLog(buf);
-            }
+            SetStatus(L"Checking git...");
         }
+        StartWatcher();
+        StartProbe();
     }
 
     // Sync checkbox state
     SendMessageW(m_chkAutoPush, BM_SETCHECK, cfg.autoPushOnClose ? BST_CHECKED : BST_UNCHECKED, 0);
     SendMessageW(m_chkAutoPull, BM_SETCHECK, cfg.autoPullOnLaunch ? BST_CHECKED : BST_UNCHECKED, 0);
 
-    SetTimer(m_hwnd, IDT_SYNC_INITIAL, 10000, nullptr);  // Initial sync after 10s
+    m_scheduler.Configure(static_cast<uint64_t>(cfg.syncMinIntervalMin) * 60000,
+                          static_cast<uint64_t>(cfg.syncMaxStalenessMin) * 60000);
+    m_scheduler.Start(GetTickCount64(), 10000);   // Initial sync after 10s
+    ArmSyncTimer();
+
+    // Extra builds folders, each on its own schedule
+    m_profiles.SetLogCallback([this](const std::string& msg) {
+        char* copy = _strdup(msg.c_str());
+        if (!PostMessageW(m_hwnd, WM_APP_LOG, 0, reinterpret_cast<LPARAM>(copy)))
+            free(copy);
+    });
+    m_profiles.Start(cfg);
+    if (!m_profiles.Empty()) SetTimer(m_hwnd, IDT_PROFILES, 60000, nullptr);
+
+    StartCommandServer();
 }
 
 void MainWindow::CreateControls() {
@@ -248,6 +334,12 @@ void MainWindow::CreateControls() {
         reinterpret_cast<HMENU>(static_cast<INT_PTR>(ID_CHK_AUTOPUSH)),
         m_hInstance, nullptr);
 
+    m_btnStats = CreateWindowW(L"BUTTON", L"Stats",
+        WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+        x + 505, y - 4, 80, 24, m_hwnd,
+        reinterpret_cast<HMENU>(static_cast<INT_PTR>(ID_BTN_STATS)),
+        m_hInstance, nullptr);
+
     y += 30;
 
     // Log panel - multiline edit
@@ -284,6 +376,84 @@ void MainWindow::SetStatus(const std::wstring& status) {
     SetWindowTextW(m_lblStatus, status.c_str());
 }
 
+void MainWindow::ShowState(const StateSnapshot& state, bool cached) {
+    std::wstring status;
+    if (state.gitVersion.empty()) {
+        status = L"Git not found";
+    } else if (!state.repoInitialized) {
+        status = L"Repo not initialized";
+    } else if (state.conflicts > 0) {
+        status = L"Conflicts - " + std::to_wstring(state.conflicts) + L" file(s) need resolving";
+    } else if (state.changedFiles > 0 || state.ahead > 0) {
+        status = L"Ready - " + std::to_wstring(state.changedFiles) + L" changed file(s)";
+        if (state.ahead > 0) status += L", " + std::to_wstring(state.ahead) + L" commit(s) to push";
+    } else {
+        status = L"Ready";
+    }
+    if (cached) status += L" (checking...)";
+    SetStatus(status);
+}
+
+void MainWindow::StartProbe() {
+    std::string folder = m_configMgr.Get().buildsFolder;
+
+    // Changes from here on need another probe
+    m_stateStale = false;
+    if (m_probeThread.joinable()) m_probeThread.detach();
+    m_probeThread = std::thread([this, folder]() {
+        Trace::Span span("probe", "startup");
+        auto* state = new StateSnapshot();
+        state->buildsFolder = folder;
+        state->gitVersion = m_gitMgr.GetGitVersion();
+        if (!state->gitVersion.empty()) {
+            state->repoInitialized = m_gitMgr.IsRepoInitialized();
+            ChangeSet changes;
+            if (state->repoInitialized && m_gitMgr.GetStatus(changes)) {
+                state->changedFiles = changes.ChangedCount();
+                state->conflicts = changes.unmerged;
+                state->ahead = changes.ahead;
+                state->behind = changes.behind;
+                for (const auto& e : changes.entries) {
+                    if (state->changedBuilds.size() == 20) break;
+                    state->changedBuilds.emplace_back(GitStatus::FileName(e.path));
+                }
+            }
+        }
+        state->updatedAt = Utils::GetTimestamp();
+
+        if (!PostMessageW(m_hwnd, WM_APP_PROBE_DONE, 0, reinterpret_cast<LPARAM>(state)))
+            delete state;
+    });
+}
+
+void MainWindow::OnProbeDone(StateSnapshot* state) {
+    if (!state) return;
+    Trace::Span span("ui.OnProbeDone", "ui");
+
+    if (state->gitVersion.empty()) {
+        AppendLog("WARNING: git not found on PATH. Install git and restart.");
+    } else if (!state->repoInitialized) {
+        AppendLog("Git repo not initialized in builds folder. Click Setup to initialize.");
+    } else if (state->changedFiles > 0) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%d changed file(s) detected", state->changedFiles);
+        std::string names;
+        for (const auto& n : state->changedBuilds) names += (names.empty() ? ": " : ", ") + n;
+        if (state->changedFiles > static_cast<int>(state->changedBuilds.size())) names += ", ...";
+        AppendLog(buf + names);
+    }
+
+    // A sync started meanwhile owns the status label
+    if (!m_busy) ShowState(*state, false);
+
+    StateCache::Save(*state);
+    m_state = std::move(*state);
+    delete state;
+
+    for (auto& request : m_statusWaiters) request->reply.set_value(RunCommand(request->command));
+    m_statusWaiters.clear();
+}
+
 void MainWindow::AppendLog(const std::string& text) {
     // Get timestamp
     SYSTEMTIME st;
@@ -293,18 +463,20 @@ void MainWindow::AppendLog(const std::string& text) {
              st.wHour, st.wMinute, st.wSecond);
 
     std::string line = std::string(timestamp) + text + "\r\n";
-    std::wstring wline = Utils::ToWide(line);
+    Utils::ToWide(line, m_logLineBuf);
 
     // Append to edit control
     int len = GetWindowTextLengthW(m_editLog);
     SendMessageW(m_editLog, EM_SETSEL, len, len);
-    SendMessageW(m_editLog, EM_REPLACESEL, FALSE, reinterpret_cast<LPARAM>(wline.c_str()));
+    SendMessageW(m_editLog, EM_REPLACESEL, FALSE, reinterpret_cast<LPARAM>(m_logLineBuf.c_str()));
 
     // Auto-scroll to bottom
     SendMessageW(m_editLog, EM_SCROLLCARET, 0, 0);
 }
 
 void MainWindow::OnCommand(WPARAM wParam) {
+    Trace::Span span("ui.OnCommand", "ui", std::to_string(LOWORD(wParam)));
+
     switch (LOWORD(wParam)) {
     case ID_BTN_LAUNCH:
         OnLaunchDDOBuilder();
@@ -321,22 +493,46 @@ void MainWindow::OnCommand(WPARAM wParam) {
     case ID_BTN_UPDATE:
         OnUpdateDDOBuilder();
         break;
+    case ID_BTN_STATS:
+        OnShowStats();
+        break;
     case ID_CHK_AUTOPUSH:
         m_configMgr.Get().autoPushOnClose =
             (SendMessageW(m_chkAutoPush, BM_GETCHECK, 0, 0) == BST_CHECKED);
-        m_configMgr.SaveDefault();
+        m_configMgr.Commit();
         break;
     case ID_CHK_AUTOPULL:
         m_configMgr.Get().autoPullOnLaunch =
             (SendMessageW(m_chkAutoPull, BM_GETCHECK, 0, 0) == BST_CHECKED);
-        m_configMgr.SaveDefault();
+        m_configMgr.Commit();
         break;
     }
 }
 
 void MainWindow::OnDestroy() {
-    // Save config
-    m_configMgr.SaveDefault();
+    // The probe they wait for won't be delivered; don't hold up the server
+    for (auto& request : m_statusWaiters) {
+        request->reply.set_value(json{{"ok", false}, {"error", "closing"}}.dump());
+    }
+    m_statusWaiters.clear();
+    m_server.Stop();
+    m_watcher.Stop();
+    // Cancels a profile sync that is mid-flight; its journal finishes it next run
+    m_profiles.Stop();
+
+    // Save config (anything not yet written by the write-behind saver)
+    m_configMgr.Commit();
+    m_configMgr.Flush();
+    Trace::Flush();
+
+    // One sample per session, so the app's own cost rolls up like the children's
+    ProcessUsage self = Process::SelfUsage();
+    Metrics::Record("app.session.wall_min",    self.wallMs / 60000.0);
+    Metrics::Record("app.session.cpu_ms",      self.cpuUserMs + self.cpuKernelMs);
+    Metrics::Record("app.session.peak_rss_mb", self.peakRssBytes / (1024.0 * 1024.0));
+    Metrics::Record("app.session.io_read_kb",  self.ioReadBytes / 1024.0);
+    Metrics::Record("app.session.io_write_kb", self.ioWriteBytes / 1024.0);
+    Metrics::SaveFile(Metrics::DefaultPath());
     DestroyWindow(m_hwnd);
 }
 
@@ -352,11 +548,33 @@ void MainWindow::RunAsync(std::function<void()> work) {
 
     if (m_workerThread.joinable()) m_workerThread.detach();
     m_workerThread = std::thread([this, work = std::move(work)]() {
+        Trace::Span span("worker", "ui");
         work();
+        span.End();
         PostMessageW(m_hwnd, WM_APP_GIT_DONE, 0, 0);
     });
 }
 
+bool MainWindow::PullAndShowChanges(bool* pulledChanges) {
+    std::string before = m_gitMgr.HeadCommit();
+    if (!m_gitMgr.Pull()) return false;
+    std::string after = m_gitMgr.HeadCommit();
+    if (pulledChanges) *pulledChanges = after != before;
+    if (before.empty() || after == before) return true;
+
+    std::vector<BuildFileDiff> diffs;
+    if (!BuildDiff::DiffRevisions(m_gitMgr, before, after, diffs)) return true;
+    for (const auto& diff : diffs) {
+        std::string text = BuildDiff::Summary(diff);
+        size_t shown = (std::min)(diff.changes.size(), kMaxChangesShown);
+        for (size_t i = 0; i < shown; ++i) text += "\n" + BuildDiff::Describe(diff.changes[i]);
+        if (diff.changes.size() > shown)
+            text += "\n  (+" + std::to_string(diff.changes.size() - shown) + " more)";
+        m_gitMgr.LogOutput(text);
+    }
+    return true;
+}
+
 void MainWindow::OnLaunchDDOBuilder() {
     auto& cfg = m_configMgr.Get();
     if (cfg.ddoBuilderExe.empty() || !Utils::FileExists(cfg.ddoBuilderExe)) {
@@ -375,8 +593,11 @@ void MainWindow::OnLaunchDDOBuilder() {
         SetStatus(L"Pulling...");
         // Do pull synchronously before launch (on UI thread, quick operation)
         // Actually, let's do it async then launch after
-        RunAsync([this, &cfg]() {
-            m_gitMgr.Pull();
+        // The worker reads a snapshot; the UI thread may change the config meanwhile
+        auto snapshot = m_configMgr.Snapshot();
+        RunAsync([this, snapshot]() {
+            const SyncConfig& cfg = *snapshot;
+            PullAndShowChanges();
 
             // Now launch DDO Builder (from worker thread, post result)
             STARTUPINFOA si = {};
@@ -457,7 +678,7 @@ void MainWindow::OnPull() {
 
     SetStatus(L"Pulling...");
     RunAsync([this]() {
-        m_gitMgr.Pull();
+        PullAndShowChanges();
     });
 }
 
@@ -483,21 +704,158 @@ void MainWindow::OnSetup() {
         UpdateStatusLabels();
         m_gitMgr.SetWorkDir(m_configMgr.Get().buildsFolder);
         m_gitMgr.SetRepoUrl(m_configMgr.Get().gitRepoUrl);
-        m_configMgr.SaveDefault();
+        m_configMgr.Commit();
         SetStatus(L"Ready");
+        StartWatcher();
+        StartProbe();
+    }
+}
+
+void MainWindow::StartWatcher() {
+    const auto& cfg = m_configMgr.Get();
+    m_watcher.Stop();
+    if (!cfg.fsmonitorEnabled || cfg.buildsFolder.empty()) return;
+
+    // A build edit brings the next background sync forward; one message
+    // per sync is enough
+    m_watcher.SetChangeCallback([this]() {
+        m_stateStale = true;
+        if (!m_editPending.exchange(true)) PostMessageW(m_hwnd, WM_APP_LOCAL_EDIT, 0, 0);
+    });
+
+    // Needs the repo's .git for its journal; without it git just scans
+    if (!m_watcher.Start(cfg.buildsFolder, m_gitMgr.GetSyncRules())) {
+        AppendLog("Folder watcher not started - git will scan the whole builds folder");
+    }
+}
+
+void MainWindow::StartCommandServer() {
+    bool started = m_server.Start([this](const std::string& command) {
+        auto* request = new RemoteCommand();
+        request->command = command;
+        std::future<std::string> reply = request->reply.get_future();
+        if (!PostMessageW(m_hwnd, WM_APP_COMMAND, 0, reinterpret_cast<LPARAM>(request))) {
+            delete request;
+            return json{{"ok", false}, {"error", "closing"}}.dump();
+        }
+        if (reply.wait_for(kCommandTimeout) != std::future_status::ready) {
+            return json{{"ok", false}, {"error", "not responding (is a dialog open?)"}}.dump();
+        }
+        return reply.get();
+    });
+    if (!started) AppendLog("Command channel not started - shortcuts and the CLI will run on their own");
+}
+
+std::string MainWindow::RunCommand(const std::string& command) {
+    Trace::Span span("ui.RunCommand", "ui", command);
+    json reply;
+    reply["ok"] = true;
+
+    if (command == "show") {
+        if (IsIconic(m_hwnd)) ShowWindow(m_hwnd, SW_RESTORE);
+        SetForegroundWindow(m_hwnd);
+    } else if (command == "status") {
+        // The last probe; no git run, so it answers right away
+        reply["repo_initialized"] = m_state.repoInitialized;
+        reply["changed_files"]    = m_state.changedFiles;
+        reply["conflicts"]        = m_state.conflicts;
+        reply["ahead"]            = m_state.ahead;
+        reply["behind"]           = m_state.behind;
+        reply["changed_builds"]   = m_state.changedBuilds;
+        reply["updated_at"]       = m_state.updatedAt;
+        reply["busy"]             = m_busy.load();
+        reply["ddo_running"]      = m_ddoRunning.load();
+    } else if (command == "compact") {
+        if (m_busy) {
+            reply["ok"] = false;
+            reply["error"] = "another operation is in progress";
+        } else {
+            AppendLog("Running 'compact' from the command channel");
+            SetStatus(L"Compacting history...");
+            auto snapshot = m_configMgr.Snapshot();
+            RunAsync([this, snapshot]() {
+                CompactHistory(*snapshot);
+            });
+        }
+    } else if (command == "launch" || command == "pull" || command == "push") {
+        if (m_busy) {
+            reply["ok"] = false;
+            reply["error"] = "another operation is in progress";
+        } else if (command == "launch" && m_ddoRunning) {
+            reply["ok"] = false;
+            reply["error"] = "DDO Builder is already running";
+        } else {
+            AppendLog("Running '" + command + "' from the command channel");
+            if (command == "launch") OnLaunchDDOBuilder();
+            else if (command == "pull") OnPull();
+            else OnPush();
+            // Each of these logs why it didn't start
+            if (!m_busy && !m_ddoRunning) {
+                reply["ok"] = false;
+                reply["error"] = "not started, see the DDOBuildSync log";
+            }
+        }
+    } else if (command == "bundle-sync" || command.compare(0, 8, "restore ") == 0) {
+        // "restore <days> <build>": the build name may contain spaces
+        auto snapshot = m_configMgr.Snapshot();
+        bool restore = command != "bundle-sync";
+        char* end = nullptr;
+        double days = restore ? std::strtod(command.c_str() + 8, &end) : 0;
+        std::string build = restore ? end : "";
+        build.erase(0, build.find_first_not_of(' '));
+        if (m_busy) {
+            reply["ok"] = false;
+            reply["error"] = "another operation is in progress";
+        } else if (!restore && snapshot->bundleDir.empty()) {
+            reply["ok"] = false;
+            reply["error"] = "bundleDir not configured";
+        } else if (restore && (days <= 0 || build.empty())) {
+            reply["ok"] = false;
+            reply["error"] = "usage: restore <days> <build>";
+        } else {
+            AppendLog("Running '" + command + "' from the command channel");
+            RunAsync([this, snapshot, restore, days, build]() {
+                if (restore) {
+                    if (m_gitMgr.History().Update()) m_gitMgr.History().Restore(build, days);
+                    return;
+                }
+                BundleSync bundles(m_gitMgr);
+                bundles.SetDirectory(snapshot->bundleDir);
+                bundles.SetPeerName(snapshot->bundlePeerName);
+                bundles.Sync();
+            });
+        }
+    } else {
+        reply["ok"] = false;
+        reply["error"] = "unknown command: " + command;
     }
+    return reply.dump();
+}
+
+// Opens the folder browser on the path passed in lpData
+static int CALLBACK BrowseSelectProc(HWND hwnd, UINT msg, LPARAM, LPARAM lpData) {
+    if (msg == BFFM_INITIALIZED && lpData) SendMessageW(hwnd, BFFM_SETSELECTIONW, TRUE, lpData);
+    return 0;
 }
 
 bool MainWindow::RunSetupDialog() {
     auto& cfg = m_configMgr.Get();
 
-    // Step 1: Browse for DDO Builder folder
+    // Step 1: Browse for DDO Builder folder, starting at the newest install
     AppendLog("Setup: Select DDO Builder V2 folder...");
 
+    std::wstring initial = Utils::ToWide(cfg.buildsFolder);
+    if (initial.empty()) {
+        auto installs = InstallDiscovery::Discover(cfg.installSearchRoots);
+        if (!installs.empty()) initial = Utils::ToWide(installs.front().folder);
+    }
+
     BROWSEINFOW bi = {};
     bi.hwndOwner = m_hwnd;
     bi.lpszTitle = L"Select DDO Builder V2 folder";
     bi.ulFlags = BIF_RETURNONLYFSDIRS | BIF_NEWDIALOGSTYLE;
+    bi.lpfn = BrowseSelectProc;
+    bi.lParam = initial.empty() ? 0 : reinterpret_cast<LPARAM>(initial.c_str());
 
     LPITEMIDLIST pidl = SHBrowseForFolderW(&bi);
     if (!pidl) {
@@ -649,17 +1007,28 @@ bool MainWindow::RunSetupDialog() {
     }
 
     if (!m_gitMgr.IsRepoInitialized()) {
-        AppendLog("Initializing git repository...");
-
-        // Check if remote repo already has content - try clone instead
-        std::string output;
-        // First try to clone
-        AppendLog("Attempting to clone existing repo...");
+        // A second machine joins the existing repo; only the first one inits
+        CloneResult clone = CloneResult::EmptyRemote;
+        if (!cfg.gitRepoUrl.empty()) {
+            AppendLog("Attempting to clone existing repo...");
+            clone = m_gitMgr.CloneExisting();
+        }
 
-        // We need to clone into a temp location then move .git, or init fresh
-        // Simplest: if no .git, just init and push
-        if (!m_gitMgr.InitRepo()) {
-            AppendLog("Repo init had issues - you may need to push manually");
+        if (clone == CloneResult::Cloned) {
+            // Only the latest commit was fetched; pull in the rest quietly
+            RunAsync([this]() {
+                m_gitMgr.HydrateHistory();
+            });
+        } else if (clone == CloneResult::Failed) {
+            // The remote may well have builds; a fresh init pushed over
+            // them is exactly what cloning is here to avoid
+            AppendLog("ERROR: could not clone the existing repo - check the URL and network, then run Setup again");
+            return false;
+        } else {
+            AppendLog("Initializing git repository...");
+            if (!m_gitMgr.InitRepo()) {
+                AppendLog("Repo init had issues - you may need to push manually");
+            }
         }
     } else {
         AppendLog("Git repo already initialized");
@@ -676,8 +1045,9 @@ void MainWindow::OnUpdateDDOBuilder() {
         return;
     }
 
-    RunAsync([this]() {
-        auto& cfg = m_configMgr.Get();
+    auto snapshot = m_configMgr.Snapshot();
+    RunAsync([this, snapshot]() {
+        const SyncConfig& cfg = *snapshot;
 
         UpdateInfo info;
         if (!m_updater.FetchLatestRelease(info)) return;
@@ -715,29 +1085,114 @@ void MainWindow::OnUpdateDDOBuilder() {
         std::string newExe = m_updater.DownloadAndInstall(info, cfg.buildsFolder);
         if (newExe.empty()) return;
 
-        // ddoBuilderExe path stays the same (same folder), just save to confirm
-        cfg.ddoBuilderExe = newExe;
-        m_configMgr.SaveDefault();
+        // ddoBuilderExe path stays the same (same folder); the UI thread
+        // records it so the config is only ever changed there
+        char* exe = _strdup(newExe.c_str());
+        if (!PostMessageW(m_hwnd, WM_APP_EXE_UPDATED, 0, reinterpret_cast<LPARAM>(exe)))
+            free(exe);
     });
 }
 
-// ---------- Hourly auto-sync ----------
+// ---------- Resource stats ----------
+
+void MainWindow::OnShowStats() {
+    ProcessUsage self = Process::SelfUsage();
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "App: up %.0f min, cpu %.0f ms, peak RSS %.1f MB, read %.1f MB, written %.1f MB",
+             self.wallMs / 60000.0, self.cpuUserMs + self.cpuKernelMs,
+             self.peakRssBytes / (1024.0 * 1024.0),
+             self.ioReadBytes / (1024.0 * 1024.0), self.ioWriteBytes / (1024.0 * 1024.0));
+    AppendLog(buf);
+
+    std::string table = Metrics::Format();
+    if (table.empty()) {
+        AppendLog("No child process metrics recorded yet");
+        return;
+    }
+    std::istringstream iss(table);
+    std::string line;
+    while (std::getline(iss, line)) AppendLog(line);
+}
+
+// ---------- Background auto-sync ----------
+
+void MainWindow::ArmSyncTimer() {
+    uint64_t delay = m_scheduler.DelayMs(GetTickCount64());
+    // SetTimer takes a UINT; the scheduler never plans days ahead. An
+    // overdue sync still waits a second so a burst of edits settles
+    SetTimer(m_hwnd, IDT_SYNC, static_cast<UINT>((std::max)(delay, static_cast<uint64_t>(1000))), nullptr);
+}
 
 void MainWindow::OnSyncTimer() {
-    if (m_busy.load() || m_ddoRunning.load()) return;
-    if (!m_gitMgr.IsGitAvailable() || !m_gitMgr.IsRepoInitialized()) return;
+    Trace::Span span("ui.OnSyncTimer", "ui");
+    // Never sync under an open DDO Builder; closing it pushes anyway
+    if (m_busy.load() || m_ddoRunning.load() ||
+        !m_gitMgr.IsGitAvailable() || !m_gitMgr.IsRepoInitialized()) {
+        m_scheduler.Postpone(GetTickCount64());
+        ArmSyncTimer();
+        return;
+    }
 
-    RunAsync([this]() {
-        int changed = m_gitMgr.GetChangedFileCount();
-        if (changed > 0) {
-            char buf[64];
-            snprintf(buf, sizeof(buf), "Auto-sync: %d changed file(s), pushing...", changed);
+    // Opt-in; a day apart at most, since old commits only age slowly
+    uint64_t now = GetTickCount64();
+    bool compact = m_configMgr.Get().compactHistory &&
+                   (m_lastCompactTick == 0 || now - m_lastCompactTick >= kCompactIntervalMs);
+    if (compact) m_lastCompactTick = now;
+
+    RunAsync([this, compact]() {
+        SyncOutcome* outcome = new SyncOutcome();
+
+        // Local edits and unpushed commits both call for a push
+        ChangeSet changes;
+        bool known = m_gitMgr.GetStatus(changes);
+        outcome->localChanges = known && changes.NeedsPush();
+        if (outcome->localChanges) {
+            char buf[96];
+            snprintf(buf, sizeof(buf), "Auto-sync: %d changed file(s), %d unpushed commit(s), pushing...",
+                     changes.ChangedCount(), changes.ahead);
             AppendLog(buf);
-            m_gitMgr.Pull();
-            m_gitMgr.Push();
+            outcome->ok = PullAndShowChanges(&outcome->remoteChanges);
+            outcome->ok = m_gitMgr.Push() && outcome->ok;
         } else {
             AppendLog("Auto-sync: pulling latest...");
-            m_gitMgr.Pull();
+            outcome->ok = PullAndShowChanges(&outcome->remoteChanges);
+        }
+        if (!PostMessageW(m_hwnd, WM_APP_SYNC_DONE, 0, reinterpret_cast<LPARAM>(outcome)))
+            delete outcome;
+
+        // Finishes a shallow setup clone whose history fetch was interrupted
+        m_gitMgr.HydrateHistory();
+
+        // Peers on the shared folder, for machines that can't reach origin
+        auto cfg = m_configMgr.Snapshot();
+        if (!cfg->bundleDir.empty()) {
+            BundleSync bundles(m_gitMgr);
+            bundles.SetDirectory(cfg->bundleDir);
+            bundles.SetPeerName(cfg->bundlePeerName);
+            bundles.Sync();
         }
+
+        if (compact) CompactHistory(*cfg);
     });
 }
+
+bool MainWindow::CompactHistory(const SyncConfig& cfg) {
+    HistoryCompactor compactor(m_gitMgr);
+    compactor.SetAgeDays(cfg.compactAfterDays);
+    compactor.SetWeekly(cfg.compactPeriod != "day");
+    compactor.SetBundleSync(!cfg.bundleDir.empty());
+    return compactor.Run();
+}
+
+void MainWindow::OnSyncDone(SyncOutcome* outcome) {
+    if (!outcome) return;
+    // Edits the sync itself made (pulled files) shouldn't trigger another
+    m_editPending = false;
+    m_scheduler.Record(*outcome, GetTickCount64());
+    delete outcome;
+
+    ArmSyncTimer();
+    uint64_t minutes = (m_scheduler.DelayMs(GetTickCount64()) + 30000) / 60000;
+    AppendLog("Next auto-sync in " + std::to_string(minutes) + " min");
+}
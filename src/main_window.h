@@ -5,17 +5,36 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+#include "command_channel.h"
 #include "config.h"
+#include "fsmonitor.h"
 #include "git_manager.h"
+#include "profile_sync.h"
 #include "updater.h"
+#include "state_cache.h"
+#include "sync_scheduler.h"
 
 constexpr UINT WM_APP_LOG        = WM_APP + 1;
 constexpr UINT WM_APP_GIT_DONE   = WM_APP + 2;
 constexpr UINT WM_APP_DDO_EXITED = WM_APP + 3;
+constexpr UINT WM_APP_PROBE_DONE = WM_APP + 4;  // lParam: StateSnapshot* (receiver deletes)
+constexpr UINT WM_APP_EXE_UPDATED = WM_APP + 5; // lParam: _strdup'd new DDOBuilder.exe path
+constexpr UINT WM_APP_SYNC_DONE  = WM_APP + 6;  // lParam: SyncOutcome* (receiver deletes)
+constexpr UINT WM_APP_LOCAL_EDIT = WM_APP + 7;  // watcher saw a build change since the last sync
+constexpr UINT WM_APP_COMMAND    = WM_APP + 8;  // lParam: RemoteCommand* (receiver deletes)
+
+// A command from another instance or the CLI; the pipe thread waits on reply
+struct RemoteCommand {
+    std::string command;
+    std::promise<std::string> reply;    // JSON, see CommandChannel
+};
 
 // Timer IDs
-constexpr UINT IDT_SYNC_INITIAL = 1;  // fires once after 10s
-constexpr UINT IDT_SYNC_HOUR    = 2;  // fires every hour
+constexpr UINT IDT_SYNC         = 1;  // one-shot, re-armed from m_scheduler after each sync
+constexpr UINT IDT_PROFILES     = 3;  // every minute: queue due sync profiles
 
 // Control IDs
 enum {
@@ -24,6 +43,7 @@ enum {
     ID_BTN_PUSH       = 103,
     ID_BTN_SETUP      = 104,
     ID_BTN_UPDATE     = 105,
+    ID_BTN_STATS      = 106,
     ID_EDIT_LOG       = 201,
     ID_STATIC_FOLDER  = 301,
     ID_STATIC_REPO    = 302,
@@ -37,6 +57,10 @@ public:
     bool Create(HINSTANCE hInstance);
     HWND GetHwnd() const { return m_hwnd; }
 
+    // Run a command as if it came over the command channel ("show",
+    // "launch", "pull", "push", "compact", "status"); returns the JSON reply
+    std::string RunCommand(const std::string& command);
+
 private:
     static LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
     LRESULT HandleMessage(UINT msg, WPARAM wParam, LPARAM lParam);
@@ -50,6 +74,11 @@ private:
     void UpdateStatusLabels();
     void SetStatus(const std::wstring& status);
 
+    // Startup state: paint from the cached snapshot, then refresh in background
+    void ShowState(const StateSnapshot& state, bool cached);
+    void StartProbe();
+    void OnProbeDone(StateSnapshot* state);
+
     // Log output
     void AppendLog(const std::string& text);
 
@@ -59,16 +88,30 @@ private:
     void OnPush();
     void OnSetup();
     void OnUpdateDDOBuilder();
+    void OnShowStats();
 
     // Run git operation on background thread
     void RunAsync(std::function<void()> work);
 
+    // Worker thread: Pull(), then log what changed in each build it brought
+    // in. pulledChanges (optional) is set if the pull moved HEAD.
+    bool PullAndShowChanges(bool* pulledChanges = nullptr);
+
+    // Worker thread: squash old history as configured (see HistoryCompactor)
+    bool CompactHistory(const SyncConfig& cfg);
+
     // DDO Builder process monitoring
     void MonitorDDOBuilder(HANDLE hProcess);
 
     // First-run setup dialog
     bool RunSetupDialog();
 
+    // (Re)start the builds folder watcher behind git's fsmonitor hook
+    void StartWatcher();
+
+    // Serve commands from later launches and the CLI
+    void StartCommandServer();
+
     HWND m_hwnd = nullptr;
     HINSTANCE m_hInstance = nullptr;
 
@@ -78,6 +121,7 @@ private:
     HWND m_btnPush    = nullptr;
     HWND m_btnSetup   = nullptr;
     HWND m_btnUpdate  = nullptr;
+    HWND m_btnStats   = nullptr;
     HWND m_editLog   = nullptr;
     HWND m_lblFolder = nullptr;
     HWND m_lblRepo   = nullptr;
@@ -85,15 +129,30 @@ private:
     HWND m_chkAutoPush = nullptr;
     HWND m_chkAutoPull = nullptr;
 
+    std::wstring m_logLineBuf;  // reused by AppendLog to avoid an allocation per line
+
     ConfigManager m_configMgr;
     GitManager m_gitMgr;
+    FsWatcher m_watcher;
+    ProfileSyncer m_profiles;
     Updater m_updater;
+    CommandServer m_server;
+    StateSnapshot m_state;      // last probe result, for "status" over the channel
+    std::atomic<bool> m_stateStale{true};   // builds or repo changed since m_state was probed
+    std::vector<std::unique_ptr<RemoteCommand>> m_statusWaiters;    // answered by the next probe
+
+    SyncScheduler m_scheduler;
+    std::atomic<bool> m_editPending{false};     // WM_APP_LOCAL_EDIT posted since the last sync
 
     std::atomic<bool> m_busy{false};
     std::atomic<bool> m_ddoRunning{false};
     std::thread m_workerThread;
     std::thread m_monitorThread;
+    std::thread m_probeThread;
 
-    // Hourly auto-sync
+    // Background auto-sync, timed by m_scheduler
     void OnSyncTimer();
+    void OnSyncDone(SyncOutcome* outcome);
+    void ArmSyncTimer();
+    uint64_t m_lastCompactTick = 0;     // when the background sync last tried compaction
 };
@@ -0,0 +1,155 @@
+#include "metrics.h"
+#include "utils.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+
+using json = nlohmann::json;
+
+double MetricStat::Percentile(double p) const {
+    if (window.empty()) return 0.0;
+    std::vector<double> sorted = window;
+    std::sort(sorted.begin(), sorted.end());
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[idx];
+}
+
+namespace Metrics {
+
+static std::mutex s_mutex;
+static std::map<std::string, MetricStat> s_stats;
+
+static int BucketFor(double value) {
+    if (value < 1.0) return 0;
+    int b = static_cast<int>(std::floor(std::log2(value))) + 1;
+    return (std::min)(b, kMetricBuckets - 1);
+}
+
+static void PushWindow(MetricStat& st, double value) {
+    if (st.window.size() < static_cast<size_t>(kMetricWindow)) {
+        st.window.push_back(value);
+    } else {
+        st.window[st.windowNext] = value;
+    }
+    st.windowNext = (st.windowNext + 1) % kMetricWindow;
+}
+
+// Rolling window contents, oldest first
+static std::vector<double> OrderedWindow(const MetricStat& st) {
+    if (st.window.size() < static_cast<size_t>(kMetricWindow)) return st.window;
+    std::vector<double> out;
+    for (size_t i = 0; i < st.window.size(); ++i)
+        out.push_back(st.window[(st.windowNext + i) % kMetricWindow]);
+    return out;
+}
+
+// Caller holds s_mutex
+static void AddSample(MetricStat& st, double value) {
+    if (st.count == 0 || value < st.min) st.min = value;
+    if (st.count == 0 || value > st.max) st.max = value;
+    st.count++;
+    st.sum += value;
+    st.last = value;
+    st.buckets[BucketFor(value)]++;
+    PushWindow(st, value);
+}
+
+void Record(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    AddSample(s_stats[name], value);
+}
+
+std::map<std::string, MetricStat> Snapshot() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_stats;
+}
+
+std::string Format() {
+    std::string text;
+    char line[256];
+    for (const auto& [name, st] : Snapshot()) {
+        snprintf(line, sizeof(line),
+                 "%-32s n=%-5llu avg=%-8.1f p50=%-8.1f p95=%-8.1f max=%.1f\n",
+                 name.c_str(), static_cast<unsigned long long>(st.count),
+                 st.count ? st.sum / st.count : 0.0,
+                 st.Percentile(0.50), st.Percentile(0.95), st.max);
+        text += line;
+    }
+    return text;
+}
+
+static json StatToJson(const MetricStat& st) {
+    json j;
+    j["count"]   = st.count;
+    j["sum"]     = st.sum;
+    j["min"]     = st.min;
+    j["max"]     = st.max;
+    j["last"]    = st.last;
+    j["p50"]     = st.Percentile(0.50);
+    j["p95"]     = st.Percentile(0.95);
+    j["buckets"] = st.buckets;
+    j["window"]  = OrderedWindow(st);   // oldest first, so a reload keeps the order
+    return j;
+}
+
+std::string ToJson() {
+    json j = json::object();
+    for (const auto& [name, st] : Snapshot()) j[name] = StatToJson(st);
+    return j.dump(2);
+}
+
+std::string DefaultPath() {
+    return Utils::GetExeDir() + "\\ddobuildsync_metrics.json";
+}
+
+bool SaveFile(const std::string& path) {
+    std::string text = ToJson();
+    std::ofstream f(path);
+    if (!f.is_open()) return false;
+    f << text;
+    return f.good();
+}
+
+bool LoadFile(const std::string& path) {
+    std::ifstream f(path);
+    if (!f.is_open()) return false;
+
+    try {
+        json j = json::parse(f);
+        std::lock_guard<std::mutex> lock(s_mutex);
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            MetricStat& st = s_stats[it.key()];
+            const json& v = it.value();
+            uint64_t count = v.value("count", uint64_t(0));
+            if (count == 0) continue;
+
+            double min = v.value("min", 0.0), max = v.value("max", 0.0);
+            st.min = (st.count == 0) ? min : (std::min)(st.min, min);
+            st.max = (st.count == 0) ? max : (std::max)(st.max, max);
+            st.count += count;
+            st.sum   += v.value("sum", 0.0);
+            if (v.contains("buckets")) {
+                const json& b = v["buckets"];
+                for (size_t i = 0; i < b.size() && i < st.buckets.size(); ++i)
+                    st.buckets[i] += b[i].get<uint64_t>();
+            }
+            // Older samples go in first so this run's samples stay newest
+            std::vector<double> recent = OrderedWindow(st);
+            st.window.clear();
+            st.windowNext = 0;
+            if (v.contains("window")) {
+                for (const auto& x : v["window"]) PushWindow(st, x.get<double>());
+            }
+            for (double x : recent) PushWindow(st, x);
+            if (st.last == 0) st.last = v.value("last", 0.0);
+        }
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+} // namespace Metrics
@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <map>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+// Process-wide named measurements (e.g. "git.pull.network_ms").
+// Thread-safe; recorded from worker threads, read from the UI.
+// Each metric keeps lifetime totals, a log2 histogram and a rolling window
+// of recent samples for percentiles.
+constexpr int kMetricBuckets = 32;    // bucket i: [2^(i-1), 2^i), bucket 0: < 1
+constexpr int kMetricWindow  = 128;   // recent samples kept per metric
+
+struct MetricStat {
+    uint64_t count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+    double last = 0;
+    std::array<uint64_t, kMetricBuckets> buckets{};
+    std::vector<double> window;       // ring buffer of recent samples
+    size_t windowNext = 0;
+
+    // Percentile (0..1) over the rolling window
+    double Percentile(double p) const;
+};
+
+namespace Metrics {
+
+// Add one sample to the named metric
+void Record(const std::string& name, double value);
+
+// Copy of all metrics, sorted by name
+std::map<std::string, MetricStat> Snapshot();
+
+// Human-readable table of all metrics, one per line
+std::string Format();
+
+// All metrics as JSON text
+std::string ToJson();
+
+// ddobuildsync_metrics.json next to exe
+std::string DefaultPath();
+
+// Persist / restore metrics so histograms roll across runs.
+// Load merges into what is already recorded.
+bool SaveFile(const std::string& path);
+bool LoadFile(const std::string& path);
+
+} // namespace Metrics
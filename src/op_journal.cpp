@@ -0,0 +1,156 @@
+#include "op_journal.h"
+#include <nlohmann/json.hpp>
+#include <cctype>
+#include <functional>
+
+using json = nlohmann::json;
+
+// Records are a few hundred bytes; reading this much of the tail always
+// holds the last complete one
+static const DWORD kTailBytes = 4096;
+
+// Past this size the next operation starts a fresh file
+static const LONGLONG kMaxJournalBytes = 64 * 1024;
+
+static std::string ToLine(const OpRecord& rec) {
+    json j;
+    j["id"]          = rec.id;
+    j["op"]          = rec.op;
+    j["stage"]       = rec.stage;
+    j["outcome"]     = rec.outcome;
+    j["before"]      = rec.before;
+    j["after"]       = rec.after;
+    j["remote"]      = rec.remote;
+    j["pushPending"] = rec.pushPending;
+    return j.dump() + "\n";
+}
+
+static bool FromLine(const std::string& line, OpRecord& rec) {
+    try {
+        json j = json::parse(line);
+        rec.id          = j.value("id", static_cast<uint64_t>(0));
+        rec.op          = j.value("op", "");
+        rec.stage       = j.value("stage", "");
+        rec.outcome     = j.value("outcome", "");
+        rec.before      = j.value("before", "");
+        rec.after       = j.value("after", "");
+        rec.remote      = j.value("remote", "");
+        rec.pushPending = j.value("pushPending", false);
+        return !rec.op.empty();
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string OpJournal::Path() const {
+    return m_workDir + "\\.git\\ddobuildsync_ops.log";
+}
+
+std::string OpJournal::MutexName() const {
+    std::string key = m_workDir;
+    for (char& c : key) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return "Local\\DDOBuildSync_op_" + std::to_string(std::hash<std::string>()(key));
+}
+
+bool OpJournal::IsRunning() const {
+    HANDLE h = OpenMutexA(SYNCHRONIZE, FALSE, MutexName().c_str());
+    if (!h) return false;
+    CloseHandle(h);
+    return true;
+}
+
+void OpJournal::Begin(const std::string& op, const std::string& before) {
+    OpRecord last;
+    bool haveLast = Last(last);
+
+    Release();
+    m_running = CreateMutexA(nullptr, FALSE, MutexName().c_str());
+
+    m_current = OpRecord();
+    m_current.id = haveLast ? last.id + 1 : 1;
+    m_current.op = op;
+    m_current.stage = "begin";
+    m_current.before = before;
+    // A commit that never reached a remote stays owed until a push succeeds
+    m_current.pushPending = haveLast && last.pushPending;
+
+    // The last record is all recovery needs, so an oversized journal can
+    // restart with just this one
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (GetFileAttributesExA(Path().c_str(), GetFileExInfoStandard, &data) &&
+        ((static_cast<LONGLONG>(data.nFileSizeHigh) << 32) | data.nFileSizeLow) > kMaxJournalBytes) {
+        std::string tmp = Path() + ".tmp";
+        std::string line = ToLine(m_current);
+        HANDLE h = CreateFileA(tmp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h != INVALID_HANDLE_VALUE) {
+            DWORD written = 0;
+            bool ok = WriteFile(h, line.data(), static_cast<DWORD>(line.size()), &written, nullptr) &&
+                      written == line.size() && FlushFileBuffers(h);
+            CloseHandle(h);
+            if (ok && MoveFileExA(tmp.c_str(), Path().c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) return;
+            DeleteFileA(tmp.c_str());
+        }
+    }
+    Append(m_current);
+}
+
+void OpJournal::Stage(const std::string& stage) {
+    m_current.stage = stage;
+    Append(m_current);
+}
+
+void OpJournal::End(const std::string& outcome) {
+    m_current.stage = "done";
+    m_current.outcome = outcome;
+    Append(m_current);
+    Release();
+}
+
+void OpJournal::Release() {
+    if (m_running) CloseHandle(m_running);
+    m_running = nullptr;
+}
+
+bool OpJournal::Append(const OpRecord& rec) {
+    HANDLE h = CreateFileA(Path().c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr,
+                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+
+    // The stage must be on disk before the git command it announces runs
+    std::string line = ToLine(rec);
+    DWORD written = 0;
+    bool ok = WriteFile(h, line.data(), static_cast<DWORD>(line.size()), &written, nullptr) &&
+              written == line.size() && FlushFileBuffers(h);
+    CloseHandle(h);
+    return ok;
+}
+
+bool OpJournal::Last(OpRecord& out) const {
+    HANDLE h = CreateFileA(Path().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    std::string tail;
+    if (GetFileSizeEx(h, &size) && size.QuadPart > 0) {
+        DWORD want = size.QuadPart < static_cast<LONGLONG>(kTailBytes) ? static_cast<DWORD>(size.QuadPart) : kTailBytes;
+        LARGE_INTEGER pos;
+        pos.QuadPart = size.QuadPart - want;
+        tail.resize(want);
+        DWORD read = 0;
+        if (!SetFilePointerEx(h, pos, nullptr, FILE_BEGIN) || !ReadFile(h, &tail[0], want, &read, nullptr)) read = 0;
+        tail.resize(read);
+    }
+    CloseHandle(h);
+
+    // A crash mid-write leaves a last line without its '\n'; skip it
+    size_t end = tail.rfind('\n');
+    while (end != std::string::npos && end > 0) {
+        size_t start = tail.rfind('\n', end - 1);
+        start = (start == std::string::npos) ? 0 : start + 1;
+        if (FromLine(tail.substr(start, end - start), out)) return true;
+        if (start == 0) break;
+        end = start - 1;
+    }
+    return false;
+}
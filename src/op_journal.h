@@ -0,0 +1,60 @@
+#pragma once
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <cstdint>
+#include <string>
+
+// One line of the operation journal. Every line carries the whole state of
+// the operation, so the last line alone says what an interrupted run was doing.
+struct OpRecord {
+    uint64_t id = 0;            // increments per operation
+    std::string op;             // "pull", "push" or "compact"
+    std::string stage;          // see GitManager::Pull/Push; "done" when finished
+    std::string outcome;        // with "done": "ok", "failed", "conflict", "recovered"
+    std::string before;         // push: HEAD before committing; compact: main before
+    std::string after;          // push: HEAD after committing; compact: main after
+    std::string remote;         // remote pulled from
+    bool pushPending = false;   // a local commit has not reached any remote yet
+};
+
+// Append-only journal of sync operations in .git\ddobuildsync_ops.log, one
+// JSON line per stage, flushed to disk before the stage's git command runs.
+// While an operation is open its process holds a named mutex, so recovery
+// can tell an operation that was interrupted from one still running.
+class OpJournal {
+public:
+    OpJournal() = default;
+    OpJournal(const OpJournal&) = delete;
+    OpJournal& operator=(const OpJournal&) = delete;
+    ~OpJournal() { Release(); }
+
+    void SetWorkDir(const std::string& workDir) { m_workDir = workDir; }
+
+    // Start an operation; pushPending carries over from the last record
+    void Begin(const std::string& op, const std::string& before);
+
+    // Record the stage the operation is about to enter
+    void Stage(const std::string& stage);
+
+    // Finish the operation; the mutex is released
+    void End(const std::string& outcome);
+
+    OpRecord& Current() { return m_current; }
+
+    // Last complete record, read from the end of the file. False if the
+    // journal is empty or unreadable.
+    bool Last(OpRecord& out) const;
+
+    // True if some process (this one included) has an operation open here
+    bool IsRunning() const;
+
+private:
+    std::string m_workDir;
+    OpRecord m_current;
+    HANDLE m_running = nullptr;
+
+    std::string Path() const;
+    std::string MutexName() const;
+    bool Append(const OpRecord& rec);
+    void Release();
+};
@@ -0,0 +1,274 @@
+#include "process.h"
+#include "metrics.h"
+#include "utils.h"
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace Process {
+
+static double FileTimeToMs(const FILETIME& ft) {
+    ULARGE_INTEGER v;
+    v.LowPart = ft.dwLowDateTime;
+    v.HighPart = ft.dwHighDateTime;
+    return static_cast<double>(v.QuadPart) / 10000.0;   // 100 ns units
+}
+
+static double LargeIntToMs(const LARGE_INTEGER& li) {
+    return static_cast<double>(li.QuadPart) / 10000.0;
+}
+
+// Usage of a single process handle (used when job accounting is unavailable)
+static void QueryProcessUsage(HANDLE hProcess, ProcessUsage& u) {
+    FILETIME created, exited, kernel, user;
+    if (GetProcessTimes(hProcess, &created, &exited, &kernel, &user)) {
+        u.cpuKernelMs = FileTimeToMs(kernel);
+        u.cpuUserMs   = FileTimeToMs(user);
+    }
+    IO_COUNTERS io = {};
+    if (GetProcessIoCounters(hProcess, &io)) {
+        u.ioReadBytes  = io.ReadTransferCount;
+        u.ioWriteBytes = io.WriteTransferCount;
+    }
+}
+
+ProcessResult Run(const ProcessRequest& request) {
+    ProcessResult result;
+
+    SECURITY_ATTRIBUTES sa = {};
+    sa.nLength = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+
+    HANDLE hReadPipe = nullptr, hWritePipe = nullptr;
+    if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) return result;
+
+    // Don't inherit the read end
+    SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
+
+    // Optional stderr pipe, so a warning can't land in parsed stdout
+    HANDLE hErrRead = nullptr, hErrWrite = nullptr;
+    if (request.separateStderr) {
+        if (!CreatePipe(&hErrRead, &hErrWrite, &sa, 0)) {
+            CloseHandle(hReadPipe);
+            CloseHandle(hWritePipe);
+            return result;
+        }
+        SetHandleInformation(hErrRead, HANDLE_FLAG_INHERIT, 0);
+    }
+
+    // Optional stdin pipe; the child inherits the read end only
+    HANDLE hStdinRead = nullptr, hStdinWrite = nullptr;
+    if (request.stdinFeeder) {
+        if (!CreatePipe(&hStdinRead, &hStdinWrite, &sa, 1 << 16)) {
+            CloseHandle(hReadPipe);
+            CloseHandle(hWritePipe);
+            if (hErrRead) CloseHandle(hErrRead);
+            if (hErrWrite) CloseHandle(hErrWrite);
+            return result;
+        }
+        SetHandleInformation(hStdinWrite, HANDLE_FLAG_INHERIT, 0);
+    }
+
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+    si.hStdOutput = hWritePipe;
+    si.hStdError = hErrWrite ? hErrWrite : hWritePipe;
+    si.hStdInput = hStdinRead;
+    si.wShowWindow = SW_HIDE;
+
+    PROCESS_INFORMATION pi = {};
+
+    // Need a mutable buffer for CreateProcessA
+    std::string cmdBuf = request.commandLine;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Start suspended so the child is in the job before it can spawn anything
+    BOOL ok = CreateProcessA(
+        nullptr,
+        cmdBuf.data(),
+        nullptr, nullptr,
+        TRUE,           // inherit handles
+        CREATE_NO_WINDOW | CREATE_SUSPENDED | (request.environment.empty() ? 0 : CREATE_UNICODE_ENVIRONMENT),
+        request.environment.empty() ? nullptr : const_cast<wchar_t*>(request.environment.data()),
+        request.workDir.empty() ? nullptr : request.workDir.c_str(),
+        &si, &pi
+    );
+
+    // Close write end in parent so ReadFile will return when child exits,
+    // and our copy of the child's stdin so writes fail once it exits
+    CloseHandle(hWritePipe);
+    if (hErrWrite) CloseHandle(hErrWrite);
+    if (hStdinRead) CloseHandle(hStdinRead);
+
+    if (!ok) {
+        CloseHandle(hReadPipe);
+        if (hErrRead) CloseHandle(hErrRead);
+        if (hStdinWrite) CloseHandle(hStdinWrite);
+        return result;
+    }
+    result.launched = true;
+
+    // Job accounting covers the child and everything it spawns (git runs
+    // remote helpers, index-pack and hooks as separate processes)
+    HANDLE hJob = CreateJobObjectA(nullptr, nullptr);
+    bool inJob = hJob && AssignProcessToJobObject(hJob, pi.hProcess);
+    ResumeThread(pi.hThread);
+
+    // Read on a helper thread so the timeout can fire while output is pending
+    std::thread reader([hReadPipe, &result]() {
+        char buf[4096];
+        DWORD bytesRead;
+        while (ReadFile(hReadPipe, buf, sizeof(buf), &bytesRead, nullptr) && bytesRead > 0) {
+            result.output.append(buf, bytesRead);
+        }
+    });
+    std::thread errorReader;
+    if (hErrRead) {
+        errorReader = std::thread([hErrRead, &result]() {
+            char buf[4096];
+            DWORD bytesRead;
+            while (ReadFile(hErrRead, buf, sizeof(buf), &bytesRead, nullptr) && bytesRead > 0) {
+                result.errorOutput.append(buf, bytesRead);
+            }
+        });
+    }
+
+    std::thread writer;
+    if (hStdinWrite) {
+        writer = std::thread([hStdinWrite, &request]() {
+            request.stdinFeeder([hStdinWrite](const char* data, size_t size) {
+                while (size > 0) {
+                    DWORD chunk = static_cast<DWORD>((std::min)(size, static_cast<size_t>(1 << 20)));
+                    DWORD written = 0;
+                    if (!WriteFile(hStdinWrite, data, chunk, &written, nullptr)) return false;
+                    data += written;
+                    size -= written;
+                }
+                return true;
+            });
+            CloseHandle(hStdinWrite);
+        });
+    }
+
+    HANDLE waits[2] = {pi.hProcess, static_cast<HANDLE>(request.cancelEvent)};
+    DWORD wait = WaitForMultipleObjects(request.cancelEvent ? 2 : 1, waits, FALSE,
+                                        request.timeoutMs > 0 ? static_cast<DWORD>(request.timeoutMs)
+                                                              : INFINITE);
+    if (wait != WAIT_OBJECT_0) {
+        result.timedOut = wait == WAIT_TIMEOUT;
+        result.cancelled = !result.timedOut;
+        if (inJob) TerminateJobObject(hJob, 1);
+        else       TerminateProcess(pi.hProcess, 1);
+        WaitForSingleObject(pi.hProcess, 5000);
+    }
+
+    if (writer.joinable()) writer.join();
+    reader.join();
+    CloseHandle(hReadPipe);
+    if (errorReader.joinable()) errorReader.join();
+    if (hErrRead) CloseHandle(hErrRead);
+
+    DWORD exitCode = 0;
+    GetExitCodeProcess(pi.hProcess, &exitCode);
+    result.exitCode = result.timedOut || result.cancelled ? -1 : static_cast<int>(exitCode);
+
+    ProcessUsage& u = result.usage;
+    u.wallMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION acct = {};
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION ext = {};
+    if (inJob && QueryInformationJobObject(hJob, JobObjectBasicAndIoAccountingInformation,
+                                           &acct, sizeof(acct), nullptr)) {
+        u.cpuUserMs    = LargeIntToMs(acct.BasicInfo.TotalUserTime);
+        u.cpuKernelMs  = LargeIntToMs(acct.BasicInfo.TotalKernelTime);
+        u.ioReadBytes  = acct.IoInfo.ReadTransferCount;
+        u.ioWriteBytes = acct.IoInfo.WriteTransferCount;
+        if (QueryInformationJobObject(hJob, JobObjectExtendedLimitInformation,
+                                      &ext, sizeof(ext), nullptr)) {
+            u.peakCommitBytes = ext.PeakJobMemoryUsed;
+        }
+    } else {
+        QueryProcessUsage(pi.hProcess, u);
+    }
+
+    PROCESS_MEMORY_COUNTERS pmc = {};
+    pmc.cb = sizeof(pmc);
+    if (GetProcessMemoryInfo(pi.hProcess, &pmc, sizeof(pmc))) {
+        u.peakRssBytes = pmc.PeakWorkingSetSize;
+    }
+
+    if (hJob) CloseHandle(hJob);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+    return result;
+}
+
+ProcessUsage SelfUsage() {
+    ProcessUsage u;
+    HANDLE self = GetCurrentProcess();
+
+    FILETIME created, exited, kernel, user, now;
+    if (GetProcessTimes(self, &created, &exited, &kernel, &user)) {
+        GetSystemTimeAsFileTime(&now);
+        u.wallMs      = FileTimeToMs(now) - FileTimeToMs(created);
+        u.cpuKernelMs = FileTimeToMs(kernel);
+        u.cpuUserMs   = FileTimeToMs(user);
+    }
+    IO_COUNTERS io = {};
+    if (GetProcessIoCounters(self, &io)) {
+        u.ioReadBytes  = io.ReadTransferCount;
+        u.ioWriteBytes = io.WriteTransferCount;
+    }
+    PROCESS_MEMORY_COUNTERS pmc = {};
+    pmc.cb = sizeof(pmc);
+    if (GetProcessMemoryInfo(self, &pmc, sizeof(pmc))) {
+        u.peakRssBytes    = pmc.PeakWorkingSetSize;
+        u.peakCommitBytes = pmc.PeakPagefileUsage;
+    }
+    return u;
+}
+
+void RecordUsage(const std::string& operation, const ProcessUsage& usage) {
+    std::string prefix = "proc." + operation + ".";
+    Metrics::Record(prefix + "wall_ms",     usage.wallMs);
+    Metrics::Record(prefix + "cpu_ms",      usage.cpuUserMs + usage.cpuKernelMs);
+    Metrics::Record(prefix + "peak_rss_mb", usage.peakRssBytes / (1024.0 * 1024.0));
+    Metrics::Record(prefix + "io_read_kb",  usage.ioReadBytes / 1024.0);
+    Metrics::Record(prefix + "io_write_kb", usage.ioWriteBytes / 1024.0);
+}
+
+std::vector<wchar_t> BuildEnvironment(const std::string& name, const std::string& value) {
+    std::vector<std::wstring> vars;
+    std::wstring prefix = Utils::ToWide(name + "=");
+
+    wchar_t* env = GetEnvironmentStringsW();
+    if (env) {
+        for (const wchar_t* p = env; *p; p += wcslen(p) + 1) {
+            if (_wcsnicmp(p, prefix.c_str(), prefix.size()) != 0) vars.emplace_back(p);
+        }
+        FreeEnvironmentStringsW(env);
+    }
+    vars.push_back(prefix + Utils::ToWide(value));
+
+    // The block is documented to be sorted by name (case-insensitive)
+    std::sort(vars.begin(), vars.end(), [](const std::wstring& a, const std::wstring& b) {
+        return _wcsicmp(a.c_str(), b.c_str()) < 0;
+    });
+
+    std::vector<wchar_t> block;
+    for (const auto& v : vars) {
+        block.insert(block.end(), v.begin(), v.end());
+        block.push_back(L'\0');
+    }
+    block.push_back(L'\0');
+    return block;
+}
+
+} // namespace Process
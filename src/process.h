@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+// Resources used by a child process tree (or by this process)
+struct ProcessUsage {
+    double wallMs = 0;
+    double cpuUserMs = 0;
+    double cpuKernelMs = 0;
+    uint64_t peakRssBytes = 0;        // peak working set of the direct child
+    uint64_t peakCommitBytes = 0;     // peak committed memory of the whole tree
+    uint64_t ioReadBytes = 0;         // file + pipe I/O of the whole tree
+    uint64_t ioWriteBytes = 0;
+};
+
+// Writes to the child's stdin; returns false once the child stops reading
+using ProcessWriteFn = std::function<bool(const char* data, size_t size)>;
+
+struct ProcessRequest {
+    std::string commandLine;
+    std::string workDir;              // empty: inherit ours
+    std::vector<wchar_t> environment; // empty: inherit ours (see BuildEnvironment)
+    int timeoutMs = 0;                // kill the child tree after this long; 0 = no limit
+    void* cancelEvent = nullptr;      // event HANDLE; the child tree is killed once it is set
+    bool separateStderr = false;      // stderr to errorOutput instead of output
+
+    // If set, runs on its own thread to feed the child's stdin, which is
+    // closed when it returns. Unset: the child gets no stdin.
+    std::function<void(const ProcessWriteFn& write)> stdinFeeder;
+};
+
+struct ProcessResult {
+    bool launched = false;
+    bool timedOut = false;
+    bool cancelled = false;           // killed because cancelEvent was set
+    int exitCode = -1;                // -1 if the process could not be launched
+    std::string output;               // combined stdout + stderr (stdout only if separateStderr)
+    std::string errorOutput;          // stderr, if separateStderr
+    ProcessUsage usage;
+};
+
+namespace Process {
+
+// Run a hidden child process and capture its combined output (or stdout
+// and stderr apart, for output that gets parsed). The child is
+// placed in a job object, so CPU, I/O and memory of everything it spawns
+// are accounted for and the whole tree can be killed on timeout.
+ProcessResult Run(const ProcessRequest& request);
+
+// Resources used by this process since it started
+ProcessUsage SelfUsage();
+
+// Add a child's usage to Metrics under "proc.<operation>.*"
+void RecordUsage(const std::string& operation, const ProcessUsage& usage);
+
+// Copy of this process's environment with name=value (UTF-8) added or
+// replaced, as a double-NUL-terminated UTF-16 block. Wide, so values
+// outside the ANSI code page (a non-Latin user name in HOME) survive.
+std::vector<wchar_t> BuildEnvironment(const std::string& name, const std::string& value);
+
+} // namespace Process
@@ -0,0 +1,121 @@
+#include "profile_sync.h"
+#include "sync_rules.h"
+#include "trace.h"
+#include "utils.h"
+#include <algorithm>
+#include <cctype>
+
+// First round shortly after startup, like the main folder's initial sync
+static const auto kInitialDelay = std::chrono::seconds(30);
+
+void ProfileSyncer::Start(const SyncConfig& cfg) {
+    Stop();
+    m_profiles.clear();
+
+    SyncRules rules = SyncRules::FromConfig(cfg);
+    CanonicalOptions canon;
+    canon.unorderedElements.insert(cfg.canonicalUnorderedElements.begin(),
+                                   cfg.canonicalUnorderedElements.end());
+    auto now = std::chrono::steady_clock::now();
+
+    for (const auto& pc : cfg.profiles) {
+        if (pc.buildsFolder.empty()) continue;
+
+        auto p = std::make_unique<Profile>();
+        p->config = pc;
+        if (p->config.name.empty()) p->config.name = pc.buildsFolder;
+        for (char c : p->config.name) {
+            p->key += isalnum(static_cast<unsigned char>(c)) ? c : '_';
+        }
+
+        std::string name = p->config.name;
+        p->git.SetWorkDir(pc.buildsFolder);
+        p->git.SetRepoUrl(pc.gitRepoUrl);
+        p->git.SetMirrorUrls(pc.mirrorUrls);
+        p->git.SetRemoteTimeoutMs(cfg.remoteTimeoutSec * 1000);
+        p->git.SetTrace2Enabled(cfg.gitTrace2Enabled);
+        p->git.SetCanonicalize(cfg.canonicalizeBuilds, canon);
+        p->git.SetSyncRules(rules);
+        p->git.SetMergeBuilds(cfg.mergeBuilds);
+        p->git.SetLogCallback([this, name](const std::string& msg) {
+            if (m_logCb) m_logCb("[" + name + "] " + msg);
+        });
+
+        // Last known state, for the log until the first round finishes
+        if (StateCache::Load(p->state, p->key) && p->state.buildsFolder == pc.buildsFolder &&
+            p->state.changedFiles >= 0 && m_logCb) {
+            m_logCb("[" + name + "] " + std::to_string(p->state.changedFiles) +
+                    " changed file(s) as of " + p->state.updatedAt);
+        }
+        p->nextDue = now + kInitialDelay;
+        m_profiles.push_back(std::move(p));
+    }
+
+    if (m_profiles.empty()) return;
+    int workers = (std::max)(1, (std::min)(cfg.maxSyncWorkers, static_cast<int>(m_profiles.size())));
+    m_pool.Start(workers);
+}
+
+void ProfileSyncer::Stop() {
+    // A round in flight may be waiting on several remotes in turn; cancel
+    // its git children so joining the pool takes moments, not timeouts
+    for (auto& p : m_profiles) p->git.Cancel();
+    m_pool.Stop();
+}
+
+void ProfileSyncer::Tick() {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& ptr : m_profiles) {
+        Profile& p = *ptr;
+        if (now < p.nextDue || p.running.exchange(true)) continue;
+
+        int interval = (std::max)(1, p.config.syncIntervalMin);
+        p.nextDue = now + std::chrono::minutes(interval);
+        m_pool.Submit([this, &p]() {
+            SyncOne(p);
+            p.running = false;
+        });
+    }
+}
+
+void ProfileSyncer::SyncOne(Profile& p) {
+    Trace::Span span("profile.sync", "sync", p.config.name);
+    GitManager& git = p.git;
+
+    p.state.buildsFolder = p.config.buildsFolder;
+    p.state.gitVersion = git.GetGitVersion();
+    p.state.repoInitialized = !p.state.gitVersion.empty() && git.IsRepoInitialized();
+
+    // Same first-time setup as the main folder: join the remote's builds if
+    // it has any, start them from this folder only if it is empty
+    if (!p.state.gitVersion.empty() && !p.state.repoInitialized) {
+        if (p.config.gitRepoUrl.empty()) {
+            git.LogOutput("Not a sync repo and no gitRepoUrl configured");
+        } else {
+            CloneResult clone = git.CloneExisting();
+            if (clone == CloneResult::EmptyRemote) git.InitRepo();
+            else if (clone == CloneResult::Failed) git.LogOutput("Setup failed - retrying next round");
+            p.state.repoInitialized = git.IsRepoInitialized();
+        }
+    }
+
+    if (!p.state.repoInitialized) {
+        p.state.changedFiles = -1;
+    } else {
+        // Same round as the main folder's background sync
+        ChangeSet changes;
+        bool needsPush = git.GetStatus(changes) && changes.NeedsPush();
+        git.Pull();
+        if (needsPush) git.Push();
+        git.HydrateHistory();
+
+        ChangeSet after;
+        bool known = git.GetStatus(after);
+        p.state.changedFiles = known ? after.ChangedCount() : -1;
+        p.state.conflicts = after.unmerged;
+        p.state.ahead = after.ahead;
+        p.state.behind = after.behind;
+    }
+    p.state.updatedAt = Utils::GetTimestamp();
+    StateCache::Save(p.state, p.key);
+}
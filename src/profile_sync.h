@@ -0,0 +1,50 @@
+#pragma once
+#include "config.h"
+#include "git_manager.h"
+#include "state_cache.h"
+#include "worker_pool.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Background sync of the extra folders in SyncConfig::profiles. Each profile
+// has its own GitManager, cached state (StateCache under the profile's name)
+// and interval; due profiles run on one shared WorkerPool, so ten profiles
+// cost maxSyncWorkers threads and overlap their network waits.
+class ProfileSyncer {
+public:
+    ~ProfileSyncer() { Stop(); }
+
+    // Lines are prefixed with the profile name
+    void SetLogCallback(GitLogCallback cb) { m_logCb = std::move(cb); }
+
+    // Build the profiles from cfg (replacing any earlier set) and start the pool
+    void Start(const SyncConfig& cfg);
+
+    // Cancel rounds in flight (see GitManager::Cancel) and join the pool
+    void Stop();
+
+    bool Empty() const { return m_profiles.empty(); }
+
+    // Queue every profile whose interval has elapsed and isn't already
+    // syncing. Cheap; meant for a periodic UI timer.
+    void Tick();
+
+private:
+    struct Profile {
+        SyncProfile config;
+        std::string key;                    // file-name-safe name for the state cache
+        GitManager git;
+        StateSnapshot state;
+        std::atomic<bool> running{false};
+        std::chrono::steady_clock::time_point nextDue;
+    };
+
+    std::vector<std::unique_ptr<Profile>> m_profiles;
+    WorkerPool m_pool;
+    GitLogCallback m_logCb;
+
+    void SyncOne(Profile& p);
+};
@@ -0,0 +1,50 @@
+#include "state_cache.h"
+#include "utils.h"
+#include <nlohmann/json.hpp>
+#include <fstream>
+
+using json = nlohmann::json;
+
+std::string StateCache::GetStatePath(const std::string& profile) {
+    if (profile.empty()) return Utils::GetExeDir() + "\\ddobuildsync_state.json";
+    return Utils::GetExeDir() + "\\ddobuildsync_state_" + profile + ".json";
+}
+
+bool StateCache::Load(StateSnapshot& out, const std::string& profile) {
+    std::ifstream f(GetStatePath(profile));
+    if (!f.is_open()) return false;
+
+    try {
+        json j = json::parse(f);
+        out.buildsFolder    = j.value("buildsFolder", "");
+        out.gitVersion      = j.value("gitVersion", "");
+        out.repoInitialized = j.value("repoInitialized", false);
+        out.changedFiles    = j.value("changedFiles", -1);
+        out.conflicts       = j.value("conflicts", 0);
+        out.ahead           = j.value("ahead", 0);
+        out.behind          = j.value("behind", 0);
+        out.changedBuilds   = j.value("changedBuilds", std::vector<std::string>());
+        out.updatedAt       = j.value("updatedAt", "");
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool StateCache::Save(const StateSnapshot& snapshot, const std::string& profile) {
+    json j;
+    j["buildsFolder"]    = snapshot.buildsFolder;
+    j["gitVersion"]      = snapshot.gitVersion;
+    j["repoInitialized"] = snapshot.repoInitialized;
+    j["changedFiles"]    = snapshot.changedFiles;
+    j["conflicts"]       = snapshot.conflicts;
+    j["ahead"]           = snapshot.ahead;
+    j["behind"]          = snapshot.behind;
+    j["changedBuilds"]   = snapshot.changedBuilds;
+    j["updatedAt"]       = snapshot.updatedAt;
+
+    std::ofstream f(GetStatePath(profile));
+    if (!f.is_open()) return false;
+    f << j.dump(2);
+    return f.good();
+}
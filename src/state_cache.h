@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Last known repo/git state, persisted so the window can paint immediately
+// on startup while the real probes run in the background.
+struct StateSnapshot {
+    std::string buildsFolder;     // folder the snapshot was taken for
+    std::string gitVersion;       // e.g. "git version 2.45.1.windows.1", empty if not found
+    bool repoInitialized = false;
+    int changedFiles = -1;        // -1 if unknown
+    int conflicts = 0;            // unmerged paths
+    int ahead = 0;                // local commits not pushed yet
+    int behind = 0;               // upstream commits not pulled yet (as of the last fetch)
+    std::vector<std::string> changedBuilds;   // file names, first few only
+    std::string updatedAt;        // timestamp of the probe that produced this snapshot
+};
+
+class StateCache {
+public:
+    // Load snapshot from the state file next to exe. Returns true on success.
+    // Each sync profile has its own file; "" is the main builds folder.
+    static bool Load(StateSnapshot& out, const std::string& profile = "");
+
+    // Save snapshot to the state file next to exe. Returns true on success.
+    static bool Save(const StateSnapshot& snapshot, const std::string& profile = "");
+
+    // Path to the state file (next to exe)
+    static std::string GetStatePath(const std::string& profile = "");
+};
@@ -0,0 +1,213 @@
+#include "sync_rules.h"
+#include "config.h"
+#include <cctype>
+
+static std::vector<std::string> SplitPath(const std::string& path) {
+    std::vector<std::string> segs;
+    std::string cur;
+    for (char c : path) {
+        if (c == '/' || c == '\\') {
+            if (!cur.empty()) segs.push_back(cur);
+            cur.clear();
+        } else {
+            cur += c;
+        }
+    }
+    if (!cur.empty()) segs.push_back(cur);
+    return segs;
+}
+
+static std::string Lower(const std::string& s) {
+    std::string out = s;
+    for (char& c : out) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+SyncRules SyncRules::Default() {
+    SyncRules rules;
+    rules.Include("*.DDOBuild");
+    rules.Include("*.DDOBuild.backup");
+    return rules;
+}
+
+SyncRules SyncRules::FromConfig(const SyncConfig& cfg) {
+    SyncRules rules;
+
+    std::vector<std::string> folders = cfg.syncFolders;
+    if (folders.empty()) folders.push_back("");
+
+    // A character's builds are the files named after it
+    std::vector<std::string> names;
+    for (const auto& c : cfg.syncCharacters) names.push_back(c + "*");
+    if (names.empty()) names.push_back("*");
+
+    for (const auto& folder : folders) {
+        std::string prefix;
+        for (const auto& seg : SplitPath(folder)) prefix += seg + "/";
+        for (const auto& name : names) {
+            rules.Include(prefix + name + ".DDOBuild");
+            if (cfg.syncBackups) rules.Include(prefix + name + ".DDOBuild.backup");
+        }
+    }
+    for (const auto& pattern : cfg.syncExclude) rules.Exclude(pattern);
+    return rules;
+}
+
+void SyncRules::Include(const std::string& pattern) {
+    Add(pattern, true);
+}
+
+void SyncRules::Exclude(const std::string& pattern) {
+    Add(pattern, false);
+}
+
+void SyncRules::Add(const std::string& pattern, bool include) {
+    std::vector<std::string> segs = SplitPath(pattern);
+    if (segs.empty()) return;
+
+    // "dir/**" means every file below dir
+    if (segs.back() == "**") segs.push_back("*");
+    Glob glob;
+    glob.original = segs.back();
+    glob.pattern  = Lower(glob.original);
+    segs.pop_back();
+
+    int node = 0;
+    bool deep = false;
+    for (const auto& seg : segs) {
+        // Only a trailing "**" is supported; anything after it is ignored
+        if (seg == "**") {
+            deep = true;
+            break;
+        }
+        std::string key = Lower(seg);
+        auto it = m_nodes[node].children.find(key);
+        if (it == m_nodes[node].children.end()) {
+            Node child;
+            child.path = m_nodes[node].path.empty() ? seg : m_nodes[node].path + "/" + seg;
+            m_nodes.push_back(std::move(child));
+            int index = static_cast<int>(m_nodes.size()) - 1;
+            m_nodes[node].children[key] = index;
+            node = index;
+        } else {
+            node = it->second;
+        }
+        if (include) m_nodes[node].onIncludePath = true;
+    }
+
+    Node& n = m_nodes[node];
+    if (include) (deep ? n.deepIncludes : n.includes).push_back(std::move(glob));
+    else         (deep ? n.deepExcludes : n.excludes).push_back(std::move(glob));
+}
+
+// '*' matches any run (including empty), '?' one character
+bool SyncRules::GlobMatch(const std::string& glob, const std::string& name) {
+    size_t g = 0, n = 0;
+    size_t starG = std::string::npos, starN = 0;
+    while (n < name.size()) {
+        if (g < glob.size() && (glob[g] == '?' || glob[g] == name[n])) {
+            ++g;
+            ++n;
+        } else if (g < glob.size() && glob[g] == '*') {
+            starG = g++;
+            starN = n;
+        } else if (starG != std::string::npos) {
+            g = starG + 1;
+            n = ++starN;
+        } else {
+            return false;
+        }
+    }
+    while (g < glob.size() && glob[g] == '*') ++g;
+    return g == glob.size();
+}
+
+bool SyncRules::MatchFile(const std::string& relPath) const {
+    std::vector<std::string> segs = SplitPath(relPath);
+    if (segs.empty()) return false;
+    std::string name = Lower(segs.back());
+    segs.pop_back();
+
+    if (segs.empty() && (name == ".gitignore" || name == ".gitattributes")) return true;
+
+    auto any = [&name](const std::vector<Glob>& globs) {
+        for (const auto& g : globs) {
+            if (GlobMatch(g.pattern, name)) return true;
+        }
+        return false;
+    };
+
+    bool included = false, excluded = false;
+    int node = 0;
+    for (size_t depth = 0; node >= 0; ++depth) {
+        const Node& n = m_nodes[node];
+        included = included || any(n.deepIncludes);
+        excluded = excluded || any(n.deepExcludes);
+        if (depth == segs.size()) {
+            included = included || any(n.includes);
+            excluded = excluded || any(n.excludes);
+            break;
+        }
+        auto it = n.children.find(Lower(segs[depth]));
+        node = it == n.children.end() ? -1 : it->second;
+    }
+    return included && !excluded;
+}
+
+bool SyncRules::MatchDirectory(const std::string& relDir) const {
+    std::vector<std::string> segs = SplitPath(relDir);
+
+    bool deep = false;
+    int node = 0;
+    for (size_t depth = 0;; ++depth) {
+        const Node& n = m_nodes[node];
+        for (const auto& g : n.deepExcludes) {
+            if (g.pattern == "*") return false;
+        }
+        deep = deep || !n.deepIncludes.empty();
+        if (depth == segs.size()) return deep || node == 0 || n.onIncludePath;
+
+        auto it = n.children.find(Lower(segs[depth]));
+        if (it == n.children.end()) return deep;
+        node = it->second;
+    }
+}
+
+std::string SyncRules::ToGitIgnore() const {
+    std::string out;
+    out += "# Generated by DDO Build Sync from its sync rules; edits are overwritten\n";
+    out += "*\n";
+    out += "\n";
+    out += "!/.gitignore\n";
+    out += "!/.gitattributes\n";
+
+    std::string excludes;
+
+    // Depth-first in name order so the output is stable
+    std::vector<int> stack = {0};
+    while (!stack.empty()) {
+        int index = stack.back();
+        stack.pop_back();
+        const Node& n = m_nodes[index];
+        std::string prefix = n.path.empty() ? "/" : "/" + n.path + "/";
+
+        if (index != 0 && n.onIncludePath) out += "!" + prefix + "\n";
+        for (const auto& g : n.includes) out += "!" + prefix + g.original + "\n";
+        if (!n.deepIncludes.empty()) {
+            out += "!" + prefix + "**/\n";
+            for (const auto& g : n.deepIncludes) out += "!" + prefix + "**/" + g.original + "\n";
+        }
+
+        for (const auto& g : n.excludes) excludes += prefix + g.original + "\n";
+        for (const auto& g : n.deepExcludes) {
+            if (g.pattern == "*") excludes += (index == 0 ? std::string("/*") : prefix) + "\n";
+            else                  excludes += prefix + "**/" + g.original + "\n";
+        }
+
+        for (auto it = n.children.rbegin(); it != n.children.rend(); ++it) stack.push_back(it->second);
+    }
+
+    // Exclusions come last so they win over the re-includes above
+    if (!excludes.empty()) out += "\n" + excludes;
+    return out;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+struct SyncConfig;
+
+// Which files under the builds folder are synced, compiled into a
+// directory trie with per-directory file name globs. Paths are relative to
+// the builds folder, '/' or '\' separated, matched case-insensitively
+// (as git does on Windows).
+//
+// Pattern syntax: "[dir/...]name-glob". Directory segments are literal; a
+// "**" segment matches any depth below its parent. The name glob supports
+// '*' and '?'. Examples: "*.DDOBuild", "Raids/*.DDOBuild",
+// "Archive/**/*.DDOBuild", "Archive/**" (everything below Archive).
+class SyncRules {
+public:
+    // *.DDOBuild and *.DDOBuild.backup directly in the builds folder
+    static SyncRules Default();
+
+    // Rules from the sync* settings: folders x characters, backups, excludes
+    static SyncRules FromConfig(const SyncConfig& cfg);
+
+    void Include(const std::string& pattern);
+    void Exclude(const std::string& pattern);
+
+    // True if the file is synced. .gitignore / .gitattributes at the top
+    // are always synced.
+    bool MatchFile(const std::string& relPath) const;
+
+    // False if nothing below this directory can ever match, so walks
+    // (ours and git's) can skip it. "" is the builds folder itself.
+    bool MatchDirectory(const std::string& relDir) const;
+
+    // .gitignore that ignores everything and re-includes only the
+    // directories and file patterns the rules can match
+    std::string ToGitIgnore() const;
+
+private:
+    struct Glob {
+        std::string pattern;        // lowercased
+        std::string original;       // as written, for the generated .gitignore
+    };
+    struct Node {
+        std::map<std::string, int> children;      // lowercased segment -> node
+        std::string path;                         // as written, '/'-separated
+        bool onIncludePath = false;               // some include lies at or below
+        std::vector<Glob> includes, excludes;     // files directly in this dir
+        std::vector<Glob> deepIncludes, deepExcludes;  // this dir and all below
+    };
+    std::vector<Node> m_nodes = std::vector<Node>(1);   // [0] = builds folder
+
+    void Add(const std::string& pattern, bool include);
+    static bool GlobMatch(const std::string& glob, const std::string& name);
+};
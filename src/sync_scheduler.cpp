@@ -0,0 +1,76 @@
+#include "sync_scheduler.h"
+#include <algorithm>
+
+// Weight of the newest pull in the remote change rate
+static const double kRemoteRateWeight = 0.3;
+
+// At a remote rate of 1 the idle ceiling is this fraction of maxStaleness
+static const double kBusyRemoteCeiling = 0.25;
+
+SyncScheduler::SyncScheduler() : m_rng(std::random_device{}()) {}
+
+void SyncScheduler::Configure(uint64_t minIntervalMs, uint64_t maxStalenessMs, double jitter) {
+    m_minMs = (std::max)(minIntervalMs, static_cast<uint64_t>(60 * 1000));
+    m_maxMs = (std::max)(maxStalenessMs, m_minMs);
+    m_jitter = (std::min)((std::max)(jitter, 0.0), 0.5);
+    m_intervalMs = (std::min)((std::max)(m_intervalMs, m_minMs), m_maxMs);
+}
+
+void SyncScheduler::Start(uint64_t now, uint64_t startDelayMs) {
+    m_lastGood = now;
+    m_dueAt = now + startDelayMs;
+}
+
+uint64_t SyncScheduler::Jittered(uint64_t delayMs) {
+    double spread = delayMs * m_jitter;
+    std::uniform_real_distribution<double> dist(-spread, spread);
+    double d = static_cast<double>(delayMs) + dist(m_rng);
+    return static_cast<uint64_t>((std::max)(d, 1000.0));
+}
+
+void SyncScheduler::Plan(uint64_t now, uint64_t delayMs) {
+    m_dueAt = now + Jittered(delayMs);
+    // Jitter may push past the bound; the bound wins
+    m_dueAt = (std::min)(m_dueAt, m_lastGood + m_maxMs);
+    m_dueAt = (std::max)(m_dueAt, now + 1000);
+}
+
+void SyncScheduler::Record(const SyncOutcome& outcome, uint64_t now) {
+    if (!outcome.ok) {
+        // Back off from the remote while it's failing, but keep trying
+        m_failures = (std::min)(m_failures + 1, 16);
+        uint64_t retry = (std::min)(m_minMs << (m_failures - 1), m_maxMs);
+        m_dueAt = now + Jittered(retry);
+        return;
+    }
+
+    m_failures = 0;
+    m_lastGood = now;
+    m_remoteRate = (1.0 - kRemoteRateWeight) * m_remoteRate +
+                   kRemoteRateWeight * (outcome.remoteChanges ? 1.0 : 0.0);
+
+    if (outcome.localChanges || outcome.remoteChanges) {
+        m_intervalMs = m_minMs;
+    } else {
+        double ceiling = m_maxMs * (1.0 - (1.0 - kBusyRemoteCeiling) * m_remoteRate);
+        uint64_t cap = (std::max)(static_cast<uint64_t>(ceiling), m_minMs);
+        m_intervalMs = (std::min)(m_intervalMs * 2, cap);
+    }
+    Plan(now, m_intervalMs);
+}
+
+void SyncScheduler::Postpone(uint64_t now) {
+    m_dueAt = now + Jittered(m_minMs);
+}
+
+bool SyncScheduler::NoteLocalEdit(uint64_t now) {
+    // Give the user one minimum interval to finish editing before syncing
+    uint64_t due = now + m_minMs;
+    if (m_failures > 0 || due >= m_dueAt) return false;
+    m_dueAt = due;
+    return true;
+}
+
+uint64_t SyncScheduler::DelayMs(uint64_t now) const {
+    return m_dueAt > now ? m_dueAt - now : 0;
+}
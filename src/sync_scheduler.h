@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <random>
+
+// What one background sync saw
+struct SyncOutcome {
+    bool ok = false;            // the pull (and push, if any) went through
+    bool localChanges = false;  // there were edits or commits to push
+    bool remoteChanges = false; // the pull brought in new commits
+};
+
+// Picks when the next background sync runs, instead of a fixed hour:
+//  - any change (local or remote) drops the interval to the minimum
+//  - a sync that finds nothing doubles it, up to the staleness bound
+//  - remotes that change often lower that ceiling (a decaying average of
+//    how many recent pulls brought something in)
+//  - a local edit seen by the folder watcher pulls the next sync in to
+//    one minimum interval away
+//  - failures retry with their own exponential backoff
+//  - every delay is spread by +-jitter so clients don't sync in lockstep
+// No sync is ever planned later than maxStaleness after the last good one.
+// Times are milliseconds on any monotonic clock (GetTickCount64).
+class SyncScheduler {
+public:
+    SyncScheduler();
+
+    void Configure(uint64_t minIntervalMs, uint64_t maxStalenessMs, double jitter = 0.1);
+
+    // First sync after startDelayMs
+    void Start(uint64_t now, uint64_t startDelayMs);
+
+    void Record(const SyncOutcome& outcome, uint64_t now);
+
+    // The sync was due but couldn't run (busy, DDO Builder open): try
+    // again after one minimum interval
+    void Postpone(uint64_t now);
+
+    // The watcher saw a build change. True if that moved the next sync earlier.
+    bool NoteLocalEdit(uint64_t now);
+
+    // Milliseconds from now until the next sync (0 if overdue)
+    uint64_t DelayMs(uint64_t now) const;
+
+    uint64_t IntervalMs() const { return m_intervalMs; }
+
+private:
+    uint64_t m_minMs = 10 * 60 * 1000;
+    uint64_t m_maxMs = 4 * 60 * 60 * 1000;
+    double m_jitter = 0.1;
+
+    uint64_t m_intervalMs = 60 * 60 * 1000;
+    uint64_t m_dueAt = 0;
+    uint64_t m_lastGood = 0;
+    double m_remoteRate = 0.0;      // decaying share of pulls that changed something
+    int m_failures = 0;
+    std::mt19937 m_rng;
+
+    uint64_t Jittered(uint64_t delayMs);
+    void Plan(uint64_t now, uint64_t delayMs);
+};
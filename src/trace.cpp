@@ -0,0 +1,128 @@
+#include "trace.h"
+#include "utils.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+// Flush automatically once this many spans are buffered
+static const size_t kFlushThreshold = 256;
+
+static std::atomic<bool> s_enabled{false};
+static std::mutex s_mutex;
+static std::vector<std::string> s_pending;   // serialized events
+static std::string s_path;
+static size_t s_maxFileBytes = 8 * 1024 * 1024;
+
+static std::string DefaultPath() {
+    return Utils::GetExeDir() + "\\ddobuildsync_trace.json";
+}
+
+void SetEnabled(bool enabled) {
+    s_enabled = enabled;
+    if (!enabled) Flush();
+}
+
+bool IsEnabled() {
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+void SetOutputPath(const std::string& path) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_path = path;
+}
+
+void SetMaxFileBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_maxFileBytes = bytes;
+}
+
+// Caller holds s_mutex
+static void FlushLocked() {
+    if (s_pending.empty()) return;
+    if (s_path.empty()) s_path = DefaultPath();
+
+    // Rotate before appending if the current file is already too large
+    bool fresh = true;
+    {
+        std::ifstream in(s_path, std::ios::binary | std::ios::ate);
+        if (in.is_open()) {
+            auto size = static_cast<size_t>(in.tellg());
+            in.close();
+            if (size >= s_maxFileBytes) {
+                std::string rotated = s_path;
+                size_t ext = rotated.rfind(".json");
+                if (ext != std::string::npos && ext + 5 == rotated.size())
+                    rotated.insert(ext, ".1");
+                else
+                    rotated += ".1";
+                std::remove(rotated.c_str());
+                std::rename(s_path.c_str(), rotated.c_str());
+            } else {
+                fresh = (size == 0);
+            }
+        }
+    }
+
+    std::ofstream f(s_path, std::ios::binary | std::ios::app);
+    if (!f.is_open()) {
+        s_pending.clear();
+        return;
+    }
+    if (fresh) f << "[\n";
+    for (const auto& ev : s_pending) f << ev << ",\n";
+    s_pending.clear();
+}
+
+void Flush() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    FlushLocked();
+}
+
+void Record(const char* name, const char* category,
+            std::chrono::system_clock::time_point start,
+            std::chrono::microseconds duration,
+            const std::string& detail) {
+    if (!IsEnabled()) return;
+
+    nlohmann::json ev;
+    ev["name"] = name;
+    ev["cat"]  = category;
+    ev["ph"]   = "X";
+    ev["ts"]   = std::chrono::duration_cast<std::chrono::microseconds>(
+                     start.time_since_epoch()).count();
+    ev["dur"]  = duration.count();
+    ev["pid"]  = GetCurrentProcessId();
+    ev["tid"]  = GetCurrentThreadId();
+    if (!detail.empty()) ev["args"]["detail"] = detail;
+
+    // Invalid UTF-8 in git output must not throw out of a destructor
+    std::string text = ev.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_pending.push_back(std::move(text));
+    if (s_pending.size() >= kFlushThreshold) FlushLocked();
+}
+
+Span::Span(const char* name, const char* category, const std::string& detail)
+    : m_name(name), m_category(category) {
+    if (!IsEnabled()) return;
+    m_active = true;
+    m_detail = detail;
+    m_wallStart = std::chrono::system_clock::now();
+    m_start = std::chrono::steady_clock::now();
+}
+
+void Span::End() {
+    if (!m_active) return;
+    m_active = false;
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_start);
+    Record(m_name, m_category, m_wallStart, elapsed, m_detail);
+}
+
+} // namespace Trace
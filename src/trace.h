@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <chrono>
+
+// Lightweight span tracing written as Chrome trace-event JSON
+// (load the file in chrome://tracing or https://ui.perfetto.dev).
+//
+// Spans are buffered in memory and appended to the trace file in batches.
+// The file uses the JSON array format without a closing bracket, which the
+// trace viewers accept, so batches can be appended without rewriting it.
+// When the file grows past the size limit it is rotated to *.1.json.
+// While tracing is disabled a Span costs one atomic load.
+namespace Trace {
+
+// Turn tracing on or off at runtime (SyncConfig::traceEnabled)
+void SetEnabled(bool enabled);
+bool IsEnabled();
+
+// Trace file path, default: ddobuildsync_trace.json next to exe
+void SetOutputPath(const std::string& path);
+
+// Rotate the trace file once it exceeds this size (default 8 MB)
+void SetMaxFileBytes(size_t bytes);
+
+// Append buffered spans to the trace file
+void Flush();
+
+// Record a complete span ("ph":"X") that was measured elsewhere
+void Record(const char* name, const char* category,
+            std::chrono::system_clock::time_point start,
+            std::chrono::microseconds duration,
+            const std::string& detail = {});
+
+// Scoped span: measures from construction to End() or destruction
+class Span {
+public:
+    Span(const char* name, const char* category, const std::string& detail = {});
+    ~Span() { End(); }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    // Close the span early (for sequential stages inside one function)
+    void End();
+
+private:
+    const char* m_name;
+    const char* m_category;
+    std::string m_detail;
+    bool m_active = false;
+    std::chrono::system_clock::time_point m_wallStart;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace Trace
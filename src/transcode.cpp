@@ -0,0 +1,239 @@
+#include "transcode.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+    #define TRANSCODE_AVX2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TRANSCODE_SSE2 1
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #define TRANSCODE_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace Transcode {
+
+static const char16_t kReplacement = 0xFFFD;
+
+// ---------- ASCII kernels ----------
+// Each kernel converts the longest ASCII prefix it can handle in whole
+// blocks and returns how many code units it consumed (and produced).
+
+#if TRANSCODE_AVX2
+
+static size_t AsciiToUtf16(const uint8_t* src, size_t len, char16_t* dst) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (_mm256_movemask_epi8(v) != 0) break;
+        __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+        __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 16), hi);
+    }
+    return i;
+}
+
+static size_t AsciiToUtf8(const char16_t* src, size_t len, uint8_t* dst) {
+    const __m256i mask = _mm256_set1_epi16(static_cast<short>(0xFF80));
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), mask)) break;
+        // packus works per 128-bit lane; restore order with a cross-lane permute
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    return i;
+}
+
+#elif TRANSCODE_SSE2
+
+static size_t AsciiToUtf16(const uint8_t* src, size_t len, char16_t* dst) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(v) != 0) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),     _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+    return i;
+}
+
+static size_t AsciiToUtf8(const char16_t* src, size_t len, uint8_t* dst) {
+    const __m128i mask = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+        __m128i high = _mm_and_si128(_mm_or_si128(a, b), mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+    }
+    return i;
+}
+
+#elif TRANSCODE_NEON
+
+static size_t AsciiToUtf16(const uint8_t* src, size_t len, char16_t* dst) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        if (vmaxvq_u8(v) >= 0x80) break;
+        uint16_t* out = reinterpret_cast<uint16_t*>(dst + i);
+        vst1q_u16(out,     vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(out + 8, vmovl_u8(vget_high_u8(v)));
+    }
+    return i;
+}
+
+static size_t AsciiToUtf8(const char16_t* src, size_t len, uint8_t* dst) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const uint16_t* in = reinterpret_cast<const uint16_t*>(src + i);
+        uint16x8_t a = vld1q_u16(in);
+        uint16x8_t b = vld1q_u16(in + 8);
+        if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80) break;
+        vst1q_u8(dst + i, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+    }
+    return i;
+}
+
+#else
+
+// Scalar fallback: 8 bytes at a time through a 64-bit word
+static size_t AsciiToUtf16(const uint8_t* src, size_t len, char16_t* dst) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, src + i, 8);
+        if (word & 0x8080808080808080ull) break;
+        for (size_t k = 0; k < 8; ++k) dst[i + k] = src[i + k];
+    }
+    return i;
+}
+
+static size_t AsciiToUtf8(const char16_t* src, size_t len, uint8_t* dst) {
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        uint64_t word;
+        std::memcpy(&word, src + i, 8);
+        if (word & 0xFF80FF80FF80FF80ull) break;
+        for (size_t k = 0; k < 4; ++k) dst[i + k] = static_cast<uint8_t>(src[i + k]);
+    }
+    return i;
+}
+
+#endif
+
+// ---------- Conversions ----------
+
+size_t Utf8ToUtf16(const char* text, size_t len, char16_t* dst) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(text);
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        size_t n = AsciiToUtf16(src + i, len - i, dst + o);
+        i += n;
+        o += n;
+        if (i >= len) break;
+
+        uint8_t c = src[i];
+        if (c < 0x80) {
+            dst[o++] = c;
+            ++i;
+            continue;
+        }
+
+        // Multi-byte sequence: decode and validate (no overlongs, no surrogates)
+        uint32_t cp;
+        size_t need;
+        uint32_t minCp;
+        if ((c & 0xE0) == 0xC0)      { cp = c & 0x1F; need = 1; minCp = 0x80; }
+        else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; need = 2; minCp = 0x800; }
+        else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; need = 3; minCp = 0x10000; }
+        else {
+            dst[o++] = kReplacement;
+            ++i;
+            continue;
+        }
+
+        size_t k = 1;
+        for (; k <= need && i + k < len; ++k) {
+            uint8_t cc = src[i + k];
+            if ((cc & 0xC0) != 0x80) break;
+            cp = (cp << 6) | (cc & 0x3F);
+        }
+        if (k <= need || cp < minCp || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            // Truncated or invalid: replace the lead byte and resync on the next one
+            dst[o++] = kReplacement;
+            ++i;
+            continue;
+        }
+        i += need + 1;
+
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            dst[o++] = static_cast<char16_t>(0xD800 + (cp >> 10));
+            dst[o++] = static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+        } else {
+            dst[o++] = static_cast<char16_t>(cp);
+        }
+    }
+    return o;
+}
+
+size_t Utf16ToUtf8(const char16_t* src, size_t len, char* text) {
+    uint8_t* dst = reinterpret_cast<uint8_t*>(text);
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        size_t n = AsciiToUtf8(src + i, len - i, dst + o);
+        i += n;
+        o += n;
+        if (i >= len) break;
+
+        uint32_t cp = src[i++];
+        if (cp >= 0xD800 && cp <= 0xDBFF && i < len && src[i] >= 0xDC00 && src[i] <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (src[i++] - 0xDC00);
+        } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+            cp = kReplacement;  // unpaired surrogate
+        }
+
+        if (cp < 0x80) {
+            dst[o++] = static_cast<uint8_t>(cp);
+        } else if (cp < 0x800) {
+            dst[o++] = static_cast<uint8_t>(0xC0 | (cp >> 6));
+            dst[o++] = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            dst[o++] = static_cast<uint8_t>(0xE0 | (cp >> 12));
+            dst[o++] = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+            dst[o++] = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+        } else {
+            dst[o++] = static_cast<uint8_t>(0xF0 | (cp >> 18));
+            dst[o++] = static_cast<uint8_t>(0x80 | ((cp >> 12) & 0x3F));
+            dst[o++] = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+            dst[o++] = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+        }
+    }
+    return o;
+}
+
+const char* KernelName() {
+#if TRANSCODE_AVX2
+    return "avx2";
+#elif TRANSCODE_SSE2
+    return "sse2";
+#elif TRANSCODE_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace Transcode
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+// Portable UTF-8 <-> UTF-16 transcoding (no Win32 dependency).
+//
+// Both directions convert in a single pass into a caller-provided buffer
+// sized with the Max* helpers below. Runs of ASCII are handled 16-32 code
+// units at a time by an SSE2, AVX2 or NEON kernel picked at compile time;
+// everything else goes through the scalar path. Invalid input (bad UTF-8
+// sequences, unpaired surrogates) is replaced with U+FFFD, the same as
+// MultiByteToWideChar/WideCharToMultiByte without flags.
+namespace Transcode {
+
+// Upper bound on UTF-16 units produced from utf8Len bytes of UTF-8
+constexpr size_t MaxUtf16Units(size_t utf8Len) { return utf8Len; }
+
+// Upper bound on UTF-8 bytes produced from utf16Len units of UTF-16
+constexpr size_t MaxUtf8Bytes(size_t utf16Len) { return utf16Len * 3; }
+
+// Convert UTF-8 to UTF-16. dst must hold MaxUtf16Units(len) units.
+// Returns the number of units written.
+size_t Utf8ToUtf16(const char* src, size_t len, char16_t* dst);
+
+// Convert UTF-16 to UTF-8. dst must hold MaxUtf8Bytes(len) bytes.
+// Returns the number of bytes written.
+size_t Utf16ToUtf8(const char16_t* src, size_t len, char* dst);
+
+// Name of the ASCII kernel compiled in: "avx2", "sse2", "neon" or "scalar"
+const char* KernelName();
+
+} // namespace Transcode
@@ -1,4 +1,6 @@
 #include "updater.h"
+#include "trace.h"
+#include "process.h"
 #include <nlohmann/json.hpp>
 #include <windows.h>
 #include <regex>
@@ -10,41 +12,17 @@ void Updater::Log(const std::string& msg) {
 }
 
 std::string Updater::RunHidden(const std::string& cmd, int timeoutMs) {
-    SECURITY_ATTRIBUTES sa = {};
-    sa.nLength = sizeof(sa);
-    sa.bInheritHandle = TRUE;
-
-    HANDLE hRead = nullptr, hWrite = nullptr;
-    if (!CreatePipe(&hRead, &hWrite, &sa, 0)) return "";
-    SetHandleInformation(hRead, HANDLE_FLAG_INHERIT, 0);
-
-    STARTUPINFOA si = {};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE;
-    si.hStdOutput = hWrite;
-    si.hStdError  = hWrite;
-    si.hStdInput  = INVALID_HANDLE_VALUE;
-
-    PROCESS_INFORMATION pi = {};
-    std::string cmdLine = "cmd.exe /C " + cmd;
-    BOOL ok = CreateProcessA(nullptr, &cmdLine[0], nullptr, nullptr,
-                             TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi);
-    CloseHandle(hWrite);
-    if (!ok) { CloseHandle(hRead); return ""; }
-
-    std::string result;
-    char buf[4096];
-    DWORD bytesRead;
-    while (ReadFile(hRead, buf, sizeof(buf) - 1, &bytesRead, nullptr) && bytesRead > 0) {
-        buf[bytesRead] = '\0';
-        result += buf;
-    }
-    WaitForSingleObject(pi.hProcess, static_cast<DWORD>(timeoutMs));
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
-    CloseHandle(hRead);
+    Trace::Span span("cmd", "process", cmd);
+
+    ProcessRequest request;
+    request.commandLine = "cmd.exe /C " + cmd;
+    request.timeoutMs = timeoutMs;
 
+    ProcessResult run = Process::Run(request);
+    if (!run.launched) return "";
+    Process::RecordUsage(cmd.substr(0, cmd.find(' ')), run.usage);
+
+    std::string result = std::move(run.output);
     while (!result.empty() && (result.back() == '\n' || result.back() == '\r' || result.back() == ' '))
         result.pop_back();
     return result;
@@ -81,6 +59,7 @@ bool Updater::IsNewer(const std::string& a, const std::string& b) {
 
 bool Updater::FetchLatestRelease(UpdateInfo& out) {
     Log("Checking for DDO Builder V2 updates...");
+    Trace::Span span("update.fetch", "update");
 
     std::string json = RunHidden(
         "curl -s -L -A \"DDOBuildSync/1.0\" "
@@ -93,6 +72,10 @@ bool Updater::FetchLatestRelease(UpdateInfo& out) {
         return false;
     }
 
+    return ParseRelease(json, out);
+}
+
+bool Updater::ParseRelease(const std::string& json, UpdateInfo& out) {
     try {
         auto j = nlohmann::json::parse(json);
 
@@ -123,6 +106,15 @@ bool Updater::FetchLatestRelease(UpdateInfo& out) {
     }
 }
 
+bool Updater::ExtractZip(const std::string& zipPath, const std::string& destDir) {
+    RunHidden(
+        "powershell -NoProfile -NonInteractive -Command "
+        "\"Expand-Archive -Path '" + zipPath + "' -DestinationPath '" + destDir + "' -Force\"",
+        120000
+    );
+    return GetFileAttributesA(destDir.c_str()) != INVALID_FILE_ATTRIBUTES;
+}
+
 std::string Updater::DownloadAndInstall(const UpdateInfo& info,
                                         const std::string& buildsFolder) {
     // --- Download ---
@@ -134,7 +126,9 @@ std::string Updater::DownloadAndInstall(const UpdateInfo& info,
     CreateDirectoryA(tempDir.c_str(), nullptr);
 
     Log("Downloading " + info.assetName + " (~45 MB, please wait)...");
+    Trace::Span downloadStage("update.download", "update");
     RunHidden("curl -L -o \"" + zipPath + "\" \"" + info.downloadUrl + "\"", 300000);
+    downloadStage.End();
 
     if (GetFileAttributesA(zipPath.c_str()) == INVALID_FILE_ATTRIBUTES) {
         Log("Download failed: zip not found at " + zipPath);
@@ -144,12 +138,10 @@ std::string Updater::DownloadAndInstall(const UpdateInfo& info,
     // --- Extract to temp subfolder ---
     std::string extractDir = tempDir + "extracted\\";
     Log("Extracting...");
-    RunHidden(
-        "powershell -NoProfile -NonInteractive -Command "
-        "\"Expand-Archive -Path '" + zipPath + "' -DestinationPath '" + extractDir + "' -Force\"",
-        120000
-    );
+    Trace::Span extractStage("update.extract", "update");
+    ExtractZip(zipPath, extractDir);
     DeleteFileA(zipPath.c_str());
+    extractStage.End();
 
     // The zip extracts to a subfolder: extracted/DDOBuilderV2_X.X.X.X/
     std::string extractedFolder = extractDir + "DDOBuilderV2_" + info.latestVersion + "\\";
@@ -160,13 +152,16 @@ std::string Updater::DownloadAndInstall(const UpdateInfo& info,
 
     // --- Merge into existing buildsFolder (overwrite exe/data, keep .DDOBuild + .git) ---
     Log("Installing into " + buildsFolder + "...");
+    Trace::Span copyStage("update.copy", "update");
     RunHidden(
         "robocopy \"" + extractedFolder + "\" \"" + buildsFolder +
         "\" /E /IS /IT /NFL /NDL /NJH /NJS /NC /NS",
         60000
     );
+    copyStage.End();
 
     // --- Cleanup temp ---
+    Trace::Span cleanupStage("update.cleanup", "update");
     RunHidden("rmdir /S /Q \"" + tempDir + "\"", 15000);
 
     // Verify
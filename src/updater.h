@@ -23,6 +23,12 @@ public:
     // Returns true if version string a > b (format "X.X.X.X")
     static bool IsNewer(const std::string& a, const std::string& b);
 
+    // Parse a GitHub "latest release" API response. Returns true on success.
+    bool ParseRelease(const std::string& json, UpdateInfo& out);
+
+    // Extract a zip archive into destDir (created if missing). Returns true on success.
+    bool ExtractZip(const std::string& zipPath, const std::string& destDir);
+
     // Download zip, extract to temp, merge into existing buildsFolder (overwrites exe/data,
     // leaves .DDOBuild and .git untouched). Returns DDOBuilder.exe path, or empty on error.
     std::string DownloadAndInstall(const UpdateInfo& info,
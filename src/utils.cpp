@@ -1,27 +1,39 @@
 #include "utils.h"
-#include <shlobj.h>
+#include "transcode.h"
 #include <cstdio>
 
 namespace Utils {
 
+// wchar_t is UTF-16 on Windows, so std::wstring storage can be handed to the
+// portable transcoder directly
+static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t must be UTF-16");
+
 std::wstring ToWide(const std::string& str) {
-    if (str.empty()) return {};
-    int len = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
-    if (len <= 0) return {};
-    std::wstring wstr(len - 1, 0);
-    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &wstr[0], len);
+    std::wstring wstr;
+    ToWide(str, wstr);
     return wstr;
 }
 
 std::string ToUtf8(const std::wstring& wstr) {
-    if (wstr.empty()) return {};
-    int len = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, nullptr, 0, nullptr, nullptr);
-    if (len <= 0) return {};
-    std::string str(len - 1, 0);
-    WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, &str[0], len, nullptr, nullptr);
+    std::string str;
+    ToUtf8(wstr, str);
     return str;
 }
 
+void ToWide(const std::string& str, std::wstring& out) {
+    out.resize(Transcode::MaxUtf16Units(str.size()));
+    size_t len = Transcode::Utf8ToUtf16(str.data(), str.size(),
+                                        reinterpret_cast<char16_t*>(out.data()));
+    out.resize(len);
+}
+
+void ToUtf8(const std::wstring& wstr, std::string& out) {
+    out.resize(Transcode::MaxUtf8Bytes(wstr.size()));
+    size_t len = Transcode::Utf16ToUtf8(reinterpret_cast<const char16_t*>(wstr.data()),
+                                        wstr.size(), out.data());
+    out.resize(len);
+}
+
 bool FileExists(const std::string& path) {
     DWORD attr = GetFileAttributesA(path.c_str());
     return (attr != INVALID_FILE_ATTRIBUTES) && !(attr & FILE_ATTRIBUTE_DIRECTORY);
@@ -32,22 +44,35 @@ bool DirExists(const std::string& path) {
     return (attr != INVALID_FILE_ATTRIBUTES) && (attr & FILE_ATTRIBUTE_DIRECTORY);
 }
 
-std::string AutoDetectDDOBuilderFolder() {
-    // Try Documents folder
-    char docs[MAX_PATH];
-    if (SUCCEEDED(SHGetFolderPathA(nullptr, CSIDL_PERSONAL, nullptr, 0, docs))) {
-        // Look for DDOBuilderV2* folders
-        std::string searchPath = std::string(docs) + "\\DDOBuilderV2*";
-        WIN32_FIND_DATAA fd;
-        HANDLE hFind = FindFirstFileA(searchPath.c_str(), &fd);
-        if (hFind != INVALID_HANDLE_VALUE) {
-            // Use the first match
-            std::string folder = std::string(docs) + "\\" + fd.cFileName;
-            FindClose(hFind);
-            return folder;
-        }
+bool RemoveTree(const std::string& path) {
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA((path + "\\*").c_str(), &fd);
+    if (h != INVALID_HANDLE_VALUE) {
+        do {
+            std::string name = fd.cFileName;
+            if (name == "." || name == "..") continue;
+            std::string child = path + "\\" + name;
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+                if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) RemoveDirectoryA(child.c_str());
+                else DeleteFileA(child.c_str());
+            } else if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                RemoveTree(child);
+            } else {
+                SetFileAttributesA(child.c_str(), FILE_ATTRIBUTE_NORMAL);
+                DeleteFileA(child.c_str());
+            }
+        } while (FindNextFileA(h, &fd));
+        FindClose(h);
     }
-    return {};
+    return RemoveDirectoryA(path.c_str()) != 0 || !DirExists(path);
+}
+
+std::string GetExeDir() {
+    char buf[MAX_PATH];
+    GetModuleFileNameA(nullptr, buf, MAX_PATH);
+    std::string path(buf);
+    auto pos = path.find_last_of("\\/");
+    return (pos != std::string::npos) ? path.substr(0, pos) : ".";
 }
 
 std::string GetTimestamp() {
@@ -11,14 +11,22 @@ std::wstring ToWide(const std::string& str);
 // Convert std::wstring to UTF-8 std::string
 std::string ToUtf8(const std::wstring& wstr);
 
+// Same as above, converting into `out` so its buffer can be reused across calls
+void ToWide(const std::string& str, std::wstring& out);
+void ToUtf8(const std::wstring& wstr, std::string& out);
+
 // Check if a file exists
 bool FileExists(const std::string& path);
 
 // Check if a directory exists
 bool DirExists(const std::string& path);
 
-// Try to auto-detect DDO Builder folder in common locations
-std::string AutoDetectDDOBuilderFolder();
+// Delete a directory and everything in it, read-only files (git objects)
+// included; junctions are removed, not followed. True if it is gone.
+bool RemoveTree(const std::string& path);
+
+// Directory containing the running executable (no trailing separator)
+std::string GetExeDir();
 
 // Get timestamp string for commit messages (YYYY-MM-DD HH:MM:SS)
 std::string GetTimestamp();
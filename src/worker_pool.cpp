@@ -0,0 +1,44 @@
+#include "worker_pool.h"
+
+void WorkerPool::Start(int threads) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_threads.empty()) return;
+    m_stopping = false;
+    if (threads < 1) threads = 1;
+    for (int i = 0; i < threads; ++i) m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+}
+
+void WorkerPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping || m_threads.empty()) return;
+        m_queue.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void WorkerPool::Stop() {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_queue.clear();
+        threads.swap(m_threads);
+    }
+    m_cv.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+void WorkerPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) return;
+            task = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads draining a FIFO of tasks. Lets many background jobs
+// (one per sync profile) share a bounded number of threads.
+class WorkerPool {
+public:
+    ~WorkerPool() { Stop(); }
+
+    // Start `threads` workers (at least one). No-op if already running.
+    void Start(int threads);
+
+    // Queue a task; it runs on the first free worker
+    void Submit(std::function<void()> task);
+
+    // Drop queued tasks, let running ones finish, join the workers
+    void Stop();
+
+    int ThreadCount() const { return static_cast<int>(m_threads.size()); }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_queue;
+    std::vector<std::thread> m_threads;
+    bool m_stopping = false;
+
+    void WorkerLoop();
+};
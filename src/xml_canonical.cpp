@@ -0,0 +1,209 @@
+#include "xml_canonical.h"
+#include "xml_stream.h"
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace XmlCanonical {
+
+// Deeper than any real build file; guards the recursion against junk input
+static const int kMaxDepth = 256;
+
+static std::string Trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+static std::string CollapseSpace(const std::string& s) {
+    std::string out;
+    bool space = false;
+    for (char c : s) {
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            space = true;
+            continue;
+        }
+        if (space && !out.empty()) out += ' ';
+        space = false;
+        out += c;
+    }
+    return out;
+}
+
+class Writer {
+public:
+    Writer(XmlReader& reader, const CanonicalOptions& options, std::string& error)
+        : m_reader(reader), m_options(options), m_error(error) {}
+
+    bool WriteDocument(std::string& out);
+
+private:
+    XmlReader& m_reader;
+    const CanonicalOptions& m_options;
+    std::string& m_error;
+
+    bool Fail(const std::string& msg) {
+        if (m_error.empty()) m_error = msg;
+        return false;
+    }
+
+    std::string Indent(int depth) const {
+        return std::string(static_cast<size_t>(depth * m_options.indent), ' ');
+    }
+
+    // Element text with "\n" written as the configured newline
+    std::string EscapeText(const std::string& text) const {
+        std::string escaped = Xml::Escape(text, false);
+        if (std::string(m_options.newline) == "\n") return escaped;
+        std::string out;
+        out.reserve(escaped.size() + 16);
+        for (char c : escaped) {
+            if (c == '\n') out += m_options.newline;
+            else           out += c;
+        }
+        return out;
+    }
+
+    std::string Markup(const XmlToken& tok, int depth) const;
+    bool WriteElement(const XmlToken& start, int depth, std::string& out);
+};
+
+// Comment, processing instruction or DOCTYPE on its own line
+std::string Writer::Markup(const XmlToken& tok, int depth) const {
+    std::string line = Indent(depth);
+    switch (tok.type) {
+    case XmlTokenType::Comment:
+        line += "<!--" + tok.text + "-->";
+        break;
+    case XmlTokenType::Doctype:
+        line += "<!DOCTYPE " + CollapseSpace(tok.text) + ">";
+        break;
+    default:
+        line += "<?" + CollapseSpace(tok.text) + "?>";
+        break;
+    }
+    return line + m_options.newline;
+}
+
+bool Writer::WriteElement(const XmlToken& start, int depth, std::string& out) {
+    if (depth > kMaxDepth) return Fail("elements nested too deeply");
+
+    out += Indent(depth) + "<" + start.name;
+
+    std::vector<const XmlAttribute*> attrs;
+    for (const auto& a : start.attributes) attrs.push_back(&a);
+    std::sort(attrs.begin(), attrs.end(), [](const XmlAttribute* a, const XmlAttribute* b) {
+        return a->name < b->name;
+    });
+    for (const XmlAttribute* a : attrs) {
+        out += " " + a->name + "=\"" + Xml::Escape(a->value, true) + "\"";
+    }
+
+    bool unordered = m_options.unorderedElements.count(start.name) != 0;
+    std::vector<std::string> parts;       // children, when unordered
+    std::string body;                     // children, in document order
+    std::string text;                     // pending character data
+    bool hasChildren = false;
+
+    auto addPart = [&](std::string part) {
+        if (unordered) parts.push_back(std::move(part));
+        else           body += part;
+    };
+    // Text between child elements goes on its own line, trimmed
+    auto flushMixedText = [&]() {
+        std::string trimmed = Trim(text);
+        if (!trimmed.empty()) addPart(Indent(depth + 1) + EscapeText(trimmed) + m_options.newline);
+        text.clear();
+    };
+
+    XmlToken tok;
+    for (;;) {
+        if (!m_reader.Next(tok)) {
+            if (m_reader.HasError()) return Fail(m_reader.Error());
+            return Fail("unexpected end of document inside <" + start.name + ">");
+        }
+
+        if (tok.type == XmlTokenType::EndElement) {
+            if (tok.name != start.name)
+                return Fail("line " + std::to_string(m_reader.Line()) + ": </" + tok.name +
+                            "> closes <" + start.name + ">");
+            break;
+        }
+        if (tok.type == XmlTokenType::Text) {
+            text += tok.text;
+            continue;
+        }
+
+        flushMixedText();
+        hasChildren = true;
+        if (tok.type == XmlTokenType::StartElement) {
+            std::string child;
+            if (!WriteElement(tok, depth + 1, child)) return false;
+            addPart(std::move(child));
+        } else {
+            addPart(Markup(tok, depth + 1));
+        }
+    }
+
+    if (!hasChildren) {
+        if (text.empty()) out += "/>";
+        else              out += ">" + EscapeText(text) + "</" + start.name + ">";
+        out += m_options.newline;
+        return true;
+    }
+
+    flushMixedText();
+    if (unordered) {
+        std::sort(parts.begin(), parts.end());
+        for (auto& p : parts) body += p;
+    }
+    out += ">";
+    out += m_options.newline;
+    out += body;
+    out += Indent(depth) + "</" + start.name + ">" + m_options.newline;
+    return true;
+}
+
+bool Writer::WriteDocument(std::string& out) {
+    bool sawRoot = false;
+    XmlToken tok;
+    while (m_reader.Next(tok)) {
+        switch (tok.type) {
+        case XmlTokenType::Text:
+            if (!Xml::IsWhitespace(tok.text)) return Fail("text outside the root element");
+            break;
+        case XmlTokenType::StartElement:
+            sawRoot = true;
+            if (!WriteElement(tok, 0, out)) return false;
+            break;
+        case XmlTokenType::EndElement:
+            return Fail("unmatched </" + tok.name + ">");
+        default:
+            out += Markup(tok, 0);
+            break;
+        }
+    }
+    if (m_reader.HasError()) return Fail(m_reader.Error());
+    if (!sawRoot) return Fail("no root element");
+    return true;
+}
+
+bool Canonicalize(std::istream& in, std::string& out,
+                  const CanonicalOptions& options, std::string& error) {
+    error.clear();
+    XmlReader reader(in);
+    Writer writer(reader, options, error);
+    std::string result;
+    if (!writer.WriteDocument(result)) return false;
+    out.swap(result);
+    return true;
+}
+
+bool Canonicalize(const std::string& in, std::string& out,
+                  const CanonicalOptions& options, std::string& error) {
+    std::istringstream stream(in);
+    return Canonicalize(stream, out, options, error);
+}
+
+} // namespace XmlCanonical
@@ -0,0 +1,31 @@
+#pragma once
+#include <istream>
+#include <set>
+#include <string>
+
+struct CanonicalOptions {
+    // Elements whose children are an unordered set; their child subtrees
+    // are sorted so DDO Builder reshuffling them doesn't show up as a change
+    std::set<std::string> unorderedElements;
+    const char* newline = "\r\n";     // DDO Builder writes CRLF
+    int indent = 2;
+};
+
+namespace XmlCanonical {
+
+// Deterministic form of an XML document, produced in one pass over the
+// token stream (only children of unordered elements are buffered):
+//  - one element per line, indented by depth, newline after every line
+//  - attributes sorted by name, double-quoted, minimally escaped
+//  - empty elements self-closed; text-only elements kept inline, verbatim
+//  - whitespace between elements dropped, mixed-content text trimmed
+// The result is a fixed point: canonicalizing it again changes nothing.
+// Returns false with error set if the input is not well-formed.
+bool Canonicalize(std::istream& in, std::string& out,
+                  const CanonicalOptions& options, std::string& error);
+
+// Same, for an in-memory document
+bool Canonicalize(const std::string& in, std::string& out,
+                  const CanonicalOptions& options, std::string& error);
+
+} // namespace XmlCanonical
@@ -0,0 +1,309 @@
+#include "xml_merge.h"
+#include "xml_stream.h"
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// Deeper than any build; guards the recursion against hostile input
+static const int kMaxDepth = 256;
+
+// Children that identify a repeated element, as in BuildDiff
+static const char* const kIdentityFields[] = {"Level", "Name", "TreeName", "Slot", "Type"};
+
+namespace {
+
+// One child of the element being merged: a whole subtree, serialized
+struct Item {
+    std::string key;        // name[identity]#occurrence; "#text" for text
+    std::string xml;        // compact form, no whitespace between elements
+    bool leaf = true;       // no child elements (merged as a unit)
+};
+
+struct Level {
+    std::vector<Item> items;
+    std::map<std::string, size_t> byKey;
+};
+
+} // namespace
+
+static bool IsIdentityField(const std::string& name) {
+    for (const char* f : kIdentityFields) {
+        if (name == f) return true;
+    }
+    return false;
+}
+
+static std::string Trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+static void WriteStart(const std::string& name, const std::vector<XmlAttribute>& attrs, std::string& out) {
+    out += '<';
+    out += name;
+    for (const auto& a : attrs) {
+        out += ' ';
+        out += a.name;
+        out += "=\"";
+        out += Xml::Escape(a.value, true);
+        out += '"';
+    }
+    out += '>';
+}
+
+static bool Fail(std::string& error, const std::string& msg) {
+    if (error.empty()) error = msg;
+    return false;
+}
+
+static bool NextToken(XmlReader& reader, XmlToken& tok, const std::string& inside, std::string& error) {
+    if (reader.Next(tok)) return true;
+    if (reader.HasError()) return Fail(error, reader.Error());
+    return Fail(error, "unexpected end of document inside <" + inside + ">");
+}
+
+// Copy the subtree started by `start` into xml. identity comes from the
+// element's attributes or its leaf children; text is a leaf's own text.
+static bool Capture(XmlReader& reader, const XmlToken& start, int depth, std::string& xml,
+                    std::string& identity, bool& leaf, std::string& text, std::string& error) {
+    if (depth > kMaxDepth) return Fail(error, "elements nested too deeply");
+
+    WriteStart(start.name, start.attributes, xml);
+    identity.clear();
+    for (const auto& a : start.attributes) {
+        if (IsIdentityField(a.name)) {
+            identity = a.name + "=" + a.value;
+            break;
+        }
+    }
+    leaf = true;
+    text.clear();
+
+    XmlToken tok;
+    for (;;) {
+        if (!NextToken(reader, tok, start.name, error)) return false;
+        if (tok.type == XmlTokenType::EndElement) break;
+        if (tok.type == XmlTokenType::Text) {
+            if (Xml::IsWhitespace(tok.text)) continue;
+            text += tok.text;
+            xml += Xml::Escape(tok.text, false);
+        } else if (tok.type == XmlTokenType::StartElement) {
+            leaf = false;
+            std::string childIdentity, childText;
+            bool childLeaf;
+            if (!Capture(reader, tok, depth + 1, xml, childIdentity, childLeaf, childText, error)) return false;
+            if (identity.empty() && childLeaf && IsIdentityField(tok.name)) {
+                identity = tok.name + "=" + Trim(childText);
+            }
+        }
+    }
+    xml += "</" + start.name + ">";
+    return true;
+}
+
+// Read the children of the element `start` opened, up to its end tag
+static bool ReadLevel(XmlReader& reader, const XmlToken& start, int depth, Level& level, std::string& error) {
+    std::map<std::string, int> seen;
+    XmlToken tok;
+    for (;;) {
+        if (!NextToken(reader, tok, start.name, error)) return false;
+        if (tok.type == XmlTokenType::EndElement) break;
+
+        Item item;
+        if (tok.type == XmlTokenType::Text) {
+            if (Xml::IsWhitespace(tok.text)) continue;
+            item.key = "#text";
+            item.xml = Xml::Escape(tok.text, false);
+        } else if (tok.type == XmlTokenType::StartElement) {
+            std::string identity, text;
+            if (!Capture(reader, tok, depth + 1, item.xml, identity, item.leaf, text, error)) return false;
+            item.key = identity.empty() ? tok.name : tok.name + "[" + identity + "]";
+        } else {
+            continue;
+        }
+        int n = ++seen[item.key];
+        if (n > 1) item.key += "#" + std::to_string(n);
+        level.byKey[item.key] = level.items.size();
+        level.items.push_back(std::move(item));
+    }
+    return true;
+}
+
+static const Item* Find(const Level* level, const std::string& key) {
+    if (!level) return nullptr;
+    auto it = level->byKey.find(key);
+    return it == level->byKey.end() ? nullptr : &level->items[it->second];
+}
+
+// Per attribute: the side that changed it wins; ours if both did
+static std::vector<XmlAttribute> MergeAttributes(const XmlToken* base, const XmlToken& ours,
+                                                 const XmlToken& theirs, XmlMergeStats& stats) {
+    auto find = [](const XmlToken* t, const std::string& name) -> const std::string* {
+        if (!t) return nullptr;
+        for (const auto& a : t->attributes) {
+            if (a.name == name) return &a.value;
+        }
+        return nullptr;
+    };
+
+    std::vector<XmlAttribute> out;
+    std::vector<std::string> names;
+    for (const auto& a : ours.attributes) names.push_back(a.name);
+    for (const auto& a : theirs.attributes) {
+        if (!find(&ours, a.name)) names.push_back(a.name);
+    }
+    for (const auto& name : names) {
+        const std::string* b = find(base, name);
+        const std::string* o = find(&ours, name);
+        const std::string* t = find(&theirs, name);
+        auto same = [](const std::string* x, const std::string* y) {
+            return x == y || (x && y && *x == *y);
+        };
+        const std::string* pick;
+        if (same(o, t) || same(b, t)) {
+            pick = o;
+        } else if (same(b, o)) {
+            pick = t;
+        } else {
+            pick = o ? o : t;
+            stats.conflicts++;
+        }
+        if (pick) out.push_back({name, *pick});
+    }
+    return out;
+}
+
+static bool MergeItems(const Item* base, const Item& ours, const Item& theirs, int depth,
+                       std::string& out, XmlMergeStats& stats, std::string& error);
+
+// Merge one element whose start tags have been read from each reader
+static bool MergeElement(XmlReader* baseReader, const XmlToken* baseStart,
+                         XmlReader& oursReader, const XmlToken& oursStart,
+                         XmlReader& theirsReader, const XmlToken& theirsStart,
+                         int depth, std::string& out, XmlMergeStats& stats, std::string& error) {
+    if (depth > kMaxDepth) return Fail(error, "elements nested too deeply");
+
+    Level base, ours, theirs;
+    if (baseReader && !ReadLevel(*baseReader, *baseStart, depth, base, error)) return false;
+    if (!ReadLevel(oursReader, oursStart, depth, ours, error)) return false;
+    if (!ReadLevel(theirsReader, theirsStart, depth, theirs, error)) return false;
+    const Level* b = baseReader ? &base : nullptr;
+
+    WriteStart(oursStart.name, MergeAttributes(baseStart, oursStart, theirsStart, stats), out);
+
+    // Ours' order, with what only theirs has placed after its predecessor there
+    std::vector<std::string> order;
+    for (const auto& item : ours.items) order.push_back(item.key);
+    size_t insertAt = 0;
+    for (const auto& item : theirs.items) {
+        auto pos = std::find(order.begin(), order.end(), item.key);
+        if (pos != order.end()) {
+            insertAt = static_cast<size_t>(pos - order.begin()) + 1;
+        } else {
+            order.insert(order.begin() + insertAt, item.key);
+            ++insertAt;
+        }
+    }
+
+    for (const auto& key : order) {
+        const Item* bi = Find(b, key);
+        const Item* oi = Find(&ours, key);
+        const Item* ti = Find(&theirs, key);
+
+        if (oi && ti) {
+            if (oi->xml == ti->xml || (bi && bi->xml == ti->xml)) {
+                out += oi->xml;
+            } else if (bi && bi->xml == oi->xml) {
+                out += ti->xml;
+            } else if (!oi->leaf && !ti->leaf) {
+                if (!MergeItems(bi, *oi, *ti, depth + 1, out, stats, error)) return false;
+                stats.mergedElements++;
+            } else {
+                out += oi->xml;
+                out += ti->xml;
+                stats.conflicts++;
+            }
+        } else if (oi || ti) {
+            // On one side only: added there, or deleted on the other side.
+            // A deletion wins over an unchanged copy, not over an edit.
+            const Item* kept = oi ? oi : ti;
+            if (!bi) {
+                out += kept->xml;
+            } else if (bi->xml != kept->xml) {
+                out += kept->xml;
+                stats.conflicts++;
+            }
+        }
+    }
+
+    out += "</" + oursStart.name + ">";
+    return true;
+}
+
+static bool MergeItems(const Item* base, const Item& ours, const Item& theirs, int depth,
+                       std::string& out, XmlMergeStats& stats, std::string& error) {
+    std::istringstream baseIn(base ? base->xml : std::string());
+    std::istringstream oursIn(ours.xml);
+    std::istringstream theirsIn(theirs.xml);
+    XmlReader baseReader(baseIn), oursReader(oursIn), theirsReader(theirsIn);
+
+    XmlToken baseStart, oursStart, theirsStart;
+    if (!oursReader.Next(oursStart) || !theirsReader.Next(theirsStart) ||
+        (base && !baseReader.Next(baseStart))) {
+        return Fail(error, "internal: captured element could not be read back");
+    }
+    return MergeElement(base ? &baseReader : nullptr, base ? &baseStart : nullptr,
+                        oursReader, oursStart, theirsReader, theirsStart, depth, out, stats, error);
+}
+
+// Read up to the root's start tag; the declaration is kept for the output.
+// empty is set (and true returned) for a document with no root at all.
+static bool ReadProlog(XmlReader& reader, XmlToken& root, std::string& declaration, bool& empty,
+                       std::string& error) {
+    empty = false;
+    for (;;) {
+        if (!reader.Next(root)) {
+            if (reader.HasError()) return Fail(error, reader.Error());
+            empty = true;
+            return true;
+        }
+        if (root.type == XmlTokenType::Declaration) declaration = "<?" + root.text + "?>";
+        if (root.type == XmlTokenType::StartElement) return true;
+        if (root.type == XmlTokenType::EndElement) return Fail(error, "unmatched </" + root.name + ">");
+    }
+}
+
+namespace XmlMerge {
+
+bool Merge(std::istream& base, std::istream& ours, std::istream& theirs,
+           std::string& out, XmlMergeStats& stats, std::string& error) {
+    XmlReader baseReader(base), oursReader(ours), theirsReader(theirs);
+    XmlToken baseRoot, oursRoot, theirsRoot;
+    std::string baseDecl, oursDecl, theirsDecl;
+    bool noBase, oursEmpty, theirsEmpty;
+    if (!ReadProlog(baseReader, baseRoot, baseDecl, noBase, error) ||
+        !ReadProlog(oursReader, oursRoot, oursDecl, oursEmpty, error) ||
+        !ReadProlog(theirsReader, theirsRoot, theirsDecl, theirsEmpty, error)) {
+        return false;
+    }
+    if (oursEmpty || theirsEmpty) return Fail(error, "no root element");
+    // No base: both sides added the build (git passes an empty ancestor)
+    if (oursRoot.name != theirsRoot.name || (!noBase && oursRoot.name != baseRoot.name)) {
+        return Fail(error, "root elements differ");
+    }
+
+    out = oursDecl;
+    return MergeElement(noBase ? nullptr : &baseReader, noBase ? nullptr : &baseRoot,
+                        oursReader, oursRoot, theirsReader, theirsRoot, 0, out, stats, error);
+}
+
+bool Merge(const std::string& base, const std::string& ours, const std::string& theirs,
+           std::string& out, XmlMergeStats& stats, std::string& error) {
+    std::istringstream baseIn(base), oursIn(ours), theirsIn(theirs);
+    return Merge(baseIn, oursIn, theirsIn, out, stats, error);
+}
+
+} // namespace XmlMerge
@@ -0,0 +1,38 @@
+#pragma once
+#include <istream>
+#include <string>
+
+struct XmlMergeStats {
+    int mergedElements = 0;     // elements both sides changed, merged child by child
+    int conflicts = 0;          // true conflicts, both versions kept as siblings
+};
+
+// Three-way merge of .DDOBuild XML at the element level, for git's merge
+// driver. Each element's children are matched across base, ours and theirs
+// by name plus an identifying attribute or leaf child (Level, Name,
+// TreeName, Slot, Type), or by occurrence, the same keys BuildDiff uses.
+// For each child:
+//  - changed on one side only: that side's version
+//  - changed on both sides: merged recursively, down to leaves
+//  - a leaf changed differently on both sides, or changed on one side and
+//    deleted on the other: both versions are kept (ours first, as siblings)
+// Children added by theirs go after the child theirs has before them.
+//
+// No tree of nodes is built. XmlReader streams each version once and keeps
+// each child of the root as a compact XML string. Only children changed on
+// both sides are streamed again, one level down. Comments and whitespace
+// between elements are dropped, so canonicalize the result for the file.
+// An empty base (git's ancestor for a file both sides added) merges with
+// no base: children both sides have alike are kept once, the rest from
+// either side are kept, and differing leaves are kept side by side.
+// Returns false with error set if a version isn't well-formed or the root
+// elements differ; the caller should fall back to a text merge.
+namespace XmlMerge {
+
+bool Merge(std::istream& base, std::istream& ours, std::istream& theirs,
+           std::string& out, XmlMergeStats& stats, std::string& error);
+
+bool Merge(const std::string& base, const std::string& ours, const std::string& theirs,
+           std::string& out, XmlMergeStats& stats, std::string& error);
+
+} // namespace XmlMerge
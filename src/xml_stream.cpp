@@ -0,0 +1,291 @@
+#include "xml_stream.h"
+#include <cstdlib>
+#include <cstring>
+
+static bool IsSpace(int c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool IsNameChar(int c) {
+    return c > 0x7F || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_' || c == ':' || c == '-' || c == '.';
+}
+
+static void AppendUtf8(std::string& out, unsigned long cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+XmlReader::XmlReader(std::istream& in) : m_buf(in.rdbuf()) {
+    // Skip a UTF-8 byte order mark
+    if (Peek() == 0xEF) {
+        Get();
+        if (Get() != 0xBB || Get() != 0xBF) Fail("bad byte order mark");
+    }
+}
+
+int XmlReader::Get() {
+    int c = m_buf->sbumpc();
+    if (c == '\n') m_line++;
+    return c;
+}
+
+int XmlReader::Peek() {
+    return m_buf->sgetc();
+}
+
+bool XmlReader::Fail(const std::string& msg) {
+    if (m_error.empty()) m_error = "line " + std::to_string(m_line) + ": " + msg;
+    return false;
+}
+
+void XmlReader::SkipSpace() {
+    while (IsSpace(Peek())) Get();
+}
+
+bool XmlReader::ReadName(std::string& name) {
+    name.clear();
+    while (IsNameChar(Peek())) name += static_cast<char>(Get());
+    if (name.empty()) return Fail("expected a name");
+    return true;
+}
+
+// Read up to and including terminator; out gets what came before it
+bool XmlReader::ReadUntil(const char* terminator, std::string& out) {
+    size_t n = strlen(terminator);
+    out.clear();
+    for (;;) {
+        int c = Get();
+        if (c == EOF) return Fail(std::string("unterminated, expected \"") + terminator + "\"");
+        out += static_cast<char>(c);
+        if (out.size() >= n && out.compare(out.size() - n, n, terminator) == 0) {
+            out.resize(out.size() - n);
+            return true;
+        }
+    }
+}
+
+// After '&': decode one reference into out
+bool XmlReader::DecodeReference(std::string& out) {
+    std::string ref;
+    for (;;) {
+        int c = Get();
+        if (c == ';') break;
+        if (c == EOF || ref.size() > 10) return Fail("bad entity reference");
+        ref += static_cast<char>(c);
+    }
+    if (ref == "lt")   { out += '<';  return true; }
+    if (ref == "gt")   { out += '>';  return true; }
+    if (ref == "amp")  { out += '&';  return true; }
+    if (ref == "quot") { out += '"';  return true; }
+    if (ref == "apos") { out += '\''; return true; }
+    if (ref.size() > 1 && ref[0] == '#') {
+        bool hex = ref[1] == 'x' || ref[1] == 'X';
+        const char* digits = ref.c_str() + (hex ? 2 : 1);
+        char* end = nullptr;
+        unsigned long cp = strtoul(digits, &end, hex ? 16 : 10);
+        if (*digits && end && *end == '\0' && cp > 0 && cp <= 0x10FFFF) {
+            AppendUtf8(out, cp);
+            return true;
+        }
+    }
+    return Fail("unknown entity &" + ref + ";");
+}
+
+bool XmlReader::Next(XmlToken& token) {
+    token.name.clear();
+    token.attributes.clear();
+    token.selfClosing = false;
+    token.text.clear();
+
+    if (!m_error.empty()) return false;
+
+    if (m_hasPendingEnd) {
+        m_hasPendingEnd = false;
+        token.type = XmlTokenType::EndElement;
+        token.name.swap(m_pendingEnd);
+        return true;
+    }
+
+    int c = Peek();
+    if (c == EOF) return false;
+    if (c == '<') {
+        Get();
+        return ReadMarkup(token);
+    }
+    return ReadText(token);
+}
+
+bool XmlReader::ReadMarkup(XmlToken& token) {
+    int c = Peek();
+
+    if (c == '?') {
+        Get();
+        std::string body;
+        if (!ReadUntil("?>", body)) return false;
+        token.type = body.compare(0, 4, "xml ") == 0 ? XmlTokenType::Declaration
+                                                     : XmlTokenType::Instruction;
+        token.text = body;
+        return true;
+    }
+
+    if (c == '!') {
+        Get();
+        if (Peek() == '-') {
+            Get();
+            if (Get() != '-') return Fail("bad comment");
+            token.type = XmlTokenType::Comment;
+            return ReadUntil("-->", token.text);
+        }
+        if (Peek() == '[') {
+            std::string open;
+            for (int i = 0; i < 7; ++i) open += static_cast<char>(Get());
+            if (open != "[CDATA[") return Fail("bad CDATA section");
+            token.type = XmlTokenType::Text;
+            if (!ReadUntil("]]>", token.text)) return false;
+            // CDATA content is text too; normalize its line breaks the same way
+            std::string normalized;
+            normalized.reserve(token.text.size());
+            for (size_t i = 0; i < token.text.size(); ++i) {
+                if (token.text[i] == '\r') {
+                    normalized += '\n';
+                    if (i + 1 < token.text.size() && token.text[i + 1] == '\n') ++i;
+                } else {
+                    normalized += token.text[i];
+                }
+            }
+            token.text.swap(normalized);
+            return true;
+        }
+        std::string keyword;
+        if (!ReadName(keyword) || keyword != "DOCTYPE") return Fail("unsupported markup declaration");
+        token.type = XmlTokenType::Doctype;
+        int depth = 0;
+        for (;;) {
+            int d = Get();
+            if (d == EOF) return Fail("unterminated DOCTYPE");
+            if (d == '[') depth++;
+            else if (d == ']') depth--;
+            else if (d == '>' && depth <= 0) break;
+            token.text += static_cast<char>(d);
+        }
+        return true;
+    }
+
+    if (c == '/') {
+        Get();
+        token.type = XmlTokenType::EndElement;
+        if (!ReadName(token.name)) return false;
+        SkipSpace();
+        if (Get() != '>') return Fail("expected '>' after </" + token.name);
+        return true;
+    }
+
+    return ReadStartTag(token);
+}
+
+bool XmlReader::ReadStartTag(XmlToken& token) {
+    token.type = XmlTokenType::StartElement;
+    if (!ReadName(token.name)) return false;
+
+    for (;;) {
+        SkipSpace();
+        int c = Peek();
+        if (c == '>') {
+            Get();
+            return true;
+        }
+        if (c == '/') {
+            Get();
+            if (Get() != '>') return Fail("expected '>' after '/'");
+            token.selfClosing = true;
+            m_pendingEnd = token.name;
+            m_hasPendingEnd = true;
+            return true;
+        }
+
+        XmlAttribute attr;
+        if (!ReadName(attr.name)) return false;
+        SkipSpace();
+        if (Get() != '=') return Fail("expected '=' after attribute " + attr.name);
+        SkipSpace();
+        int quote = Get();
+        if (quote != '"' && quote != '\'') return Fail("expected quoted value for " + attr.name);
+        for (;;) {
+            int d = Get();
+            if (d == EOF) return Fail("unterminated attribute value");
+            if (d == quote) break;
+            if (d == '&') {
+                if (!DecodeReference(attr.value)) return false;
+            } else if (d == '<') {
+                return Fail("'<' in attribute value");
+            } else if (IsSpace(d)) {
+                // Attribute value normalization: literal whitespace becomes a space
+                if (d == '\r' && Peek() == '\n') Get();
+                attr.value += ' ';
+            } else {
+                attr.value += static_cast<char>(d);
+            }
+        }
+        token.attributes.push_back(std::move(attr));
+    }
+}
+
+bool XmlReader::ReadText(XmlToken& token) {
+    token.type = XmlTokenType::Text;
+    for (;;) {
+        int c = Peek();
+        if (c == EOF || c == '<') return true;
+        Get();
+        if (c == '&') {
+            if (!DecodeReference(token.text)) return false;
+        } else if (c == '\r') {
+            if (Peek() == '\n') Get();
+            token.text += '\n';
+        } else {
+            token.text += static_cast<char>(c);
+        }
+    }
+}
+
+namespace Xml {
+
+std::string Escape(const std::string& s, bool attribute) {
+    std::string out;
+    out.reserve(s.size() + 8);
+    for (char c : s) {
+        switch (c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;";  break;
+        case '>': out += "&gt;";  break;
+        case '"':  if (attribute) out += "&quot;"; else out += c; break;
+        case '\t': if (attribute) out += "&#9;";   else out += c; break;
+        case '\n': if (attribute) out += "&#10;";  else out += c; break;
+        case '\r': out += "&#13;"; break;     // a literal CR would be read back as LF
+        default:   out += c; break;
+        }
+    }
+    return out;
+}
+
+bool IsWhitespace(const std::string& s) {
+    for (char c : s) {
+        if (!IsSpace(static_cast<unsigned char>(c))) return false;
+    }
+    return true;
+}
+
+} // namespace Xml
@@ -0,0 +1,74 @@
+#pragma once
+#include <istream>
+#include <string>
+#include <vector>
+
+// Pull tokenizer for the XML DDO Builder writes. No DOM: callers see one
+// token at a time and keep only what they need. Entity and character
+// references are decoded, CDATA is returned as text and line breaks in
+// text and attribute values are normalized to "\n" as an XML parser would.
+
+enum class XmlTokenType {
+    Declaration,      // <?xml ...?>; text holds what is between "<?" and "?>"
+    Instruction,      // other <?...?>
+    Comment,          // text holds the comment body
+    Doctype,          // text holds everything between "<!DOCTYPE" and ">"
+    StartElement,     // name + attributes; selfClosing for <x/>
+    EndElement,       // name (also emitted right after a self-closing start)
+    Text              // decoded character data, including whitespace runs
+};
+
+struct XmlAttribute {
+    std::string name;
+    std::string value;    // decoded
+};
+
+struct XmlToken {
+    XmlTokenType type = XmlTokenType::Text;
+    std::string name;
+    std::vector<XmlAttribute> attributes;
+    bool selfClosing = false;
+    std::string text;
+};
+
+class XmlReader {
+public:
+    explicit XmlReader(std::istream& in);
+
+    // Next token. Returns false at end of input or on malformed XML;
+    // HasError() tells which.
+    bool Next(XmlToken& token);
+
+    bool HasError() const { return !m_error.empty(); }
+    const std::string& Error() const { return m_error; }
+    int Line() const { return m_line; }
+
+private:
+    std::streambuf* m_buf;
+    int m_line = 1;
+    std::string m_error;
+    std::string m_pendingEnd;     // end tag owed for a self-closing element
+    bool m_hasPendingEnd = false;
+
+    int Get();
+    int Peek();
+    bool Fail(const std::string& msg);
+    void SkipSpace();
+    bool ReadName(std::string& name);
+    bool ReadUntil(const char* terminator, std::string& out);
+    bool DecodeReference(std::string& out);
+    bool ReadMarkup(XmlToken& token);
+    bool ReadStartTag(XmlToken& token);
+    bool ReadText(XmlToken& token);
+};
+
+namespace Xml {
+
+// Escape for element text (&, <, >) or for a double-quoted attribute value
+// (also " and tab/newline as character references, so they round-trip)
+std::string Escape(const std::string& s, bool attribute);
+
+// True if s only holds XML whitespace
+bool IsWhitespace(const std::string& s);
+
+} // namespace Xml
@@ -0,0 +1,469 @@
+// ddobuildsync_cli - headless front end to the sync core.
+//
+// Usage: ddobuildsync_cli <command> [--json]
+//
+//   status          number of changed build files in the configured builds folder
+//   pull            pull latest builds from the remote
+//   push            commit and push local build changes
+//   launch          pull (if enabled) and start DDO Builder, through the app
+//   bundle-sync     exchange commits with peers through the configured
+//                   bundle folder (no network)
+//   diff [<from> [<to>]]
+//                   what changed in each build between two revisions
+//                   (default: HEAD@{1} to HEAD, i.e. the last pull)
+//   history <build> commits that changed one build, newest first
+//   restore <build> <days>
+//                   put the version of a build from <days> ago back into
+//                   the builds folder (the next push commits it)
+//   compact         squash history older than compactAfterDays into one
+//                   commit per compactPeriod, rewriting main on origin
+//                   (originals kept on refs/archive/main-<time>)
+//   stats           resource metrics saved by the app (git/child process CPU,
+//                   memory and I/O histograms), plus this run's own usage
+//   canonicalize    clean filter: canonical form of the .DDOBuild on stdin
+//   filter-process  the same, as a long-running git filter process
+//   fsmonitor <version> <token>
+//                   git's core.fsmonitor hook (protocol 2), answered from
+//                   the change journal of the running app
+//   merge-driver <base> <ours> <theirs> <path>
+//                   git's merge driver for *.DDOBuild: three-way merge per
+//                   XML element, the result written over <ours>
+//
+// Reads the same config next to the exe as DDOBuildSync. With --json, the
+// command's metrics and this process's usage are printed as JSON on stdout
+// after the command's log lines (which go to stderr).
+//
+// While DDOBuildSync is running it owns the repo: status, pull, push,
+// compact, bundle-sync, restore and launch are handed to it over its
+// command channel and return at once (all but status run in the app; their
+// result is in its log). diff and history only read, and history then
+// skips updating the index (the app does that after every sync).
+
+#include "build_diff.h"
+#include "bundle_sync.h"
+#include "command_channel.h"
+#include "config.h"
+#include "fsmonitor.h"
+#include "git_filter.h"
+#include "git_manager.h"
+#include "history_compact.h"
+#include "metrics.h"
+#include "process.h"
+#include "utils.h"
+#include "xml_canonical.h"
+#include "xml_merge.h"
+#include <nlohmann/json.hpp>
+#include <fcntl.h>
+#include <io.h>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+static json UsageToJson(const ProcessUsage& u) {
+    json j;
+    j["wall_ms"]           = u.wallMs;
+    j["cpu_user_ms"]       = u.cpuUserMs;
+    j["cpu_kernel_ms"]     = u.cpuKernelMs;
+    j["peak_rss_bytes"]    = u.peakRssBytes;
+    j["peak_commit_bytes"] = u.peakCommitBytes;
+    j["io_read_bytes"]     = u.ioReadBytes;
+    j["io_write_bytes"]    = u.ioWriteBytes;
+    return j;
+}
+
+static void PrintUsage() {
+    std::fprintf(stderr,
+        "Usage: ddobuildsync_cli <status|pull|push|launch|bundle-sync|compact|stats> [--json]\n"
+        "       ddobuildsync_cli diff [<from> [<to>]] [--json]\n"
+        "       ddobuildsync_cli history <build> [--json]\n"
+        "       ddobuildsync_cli restore <build> <days>\n"
+        "       ddobuildsync_cli <canonicalize|filter-process>\n"
+        "       ddobuildsync_cli fsmonitor <version> <token>\n"
+        "       ddobuildsync_cli merge-driver <base> <ours> <theirs> <path>\n");
+}
+
+static CanonicalOptions CanonicalOptionsFor(const SyncConfig& cfg) {
+    CanonicalOptions options;
+    options.unorderedElements.insert(cfg.canonicalUnorderedElements.begin(),
+                                     cfg.canonicalUnorderedElements.end());
+    return options;
+}
+
+// Invoked by git with the file on stdin / pkt-lines on stdin. Anything that
+// isn't well-formed XML passes through untouched, so a filter problem can
+// never lose build data.
+static int RunCleanFilter(bool processProtocol) {
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+
+    ConfigManager configMgr;
+    configMgr.LoadDefault();
+    const SyncConfig& cfg = configMgr.Get();
+    CanonicalOptions options = CanonicalOptionsFor(cfg);
+    bool enabled = cfg.canonicalizeBuilds;
+
+    GitCleanFn clean = [&](const std::string& path, const std::string& in, std::string& out) {
+        std::string error;
+        if (!enabled) return false;
+        if (!XmlCanonical::Canonicalize(in, out, options, error)) {
+            if (!path.empty()) std::fprintf(stderr, "ddobuildsync: %s left as-is (%s)\n",
+                                            path.c_str(), error.c_str());
+            return false;
+        }
+        return true;
+    };
+
+    if (processProtocol) return GitFilter::ServeProcess(stdin, stdout, clean);
+
+    std::ostringstream in;
+    in << std::cin.rdbuf();
+    std::string content = in.str(), out;
+    if (!clean("", content, out)) out.swap(content);
+    fwrite(out.data(), 1, out.size(), stdout);
+    return 0;
+}
+
+// Invoked by git as `<hook> <version> <token>`. Exiting non-zero makes git
+// fall back to a full scan, which is what an unknown version should do.
+static int RunFsmonitorHook(const std::string& version, const std::string& token) {
+    if (version != "2") return 1;
+    _setmode(_fileno(stdout), _O_BINARY);
+
+    // Same path string the app keys its journal on
+    ConfigManager configMgr;
+    configMgr.LoadDefault();
+    std::string answer = Fsmonitor::Answer(configMgr.Get().buildsFolder, token);
+    fwrite(answer.data(), 1, answer.size(), stdout);
+    return 0;
+}
+
+// Invoked by git as `<driver> %O %A %B %P` with the three versions in temp
+// files. Exit 0 means <ours> now holds the merged build. Builds that aren't
+// well-formed XML get git's own line merge, conflict markers and all.
+static int RunMergeDriver(const std::string& base, const std::string& ours,
+                          const std::string& theirs, const std::string& path) {
+    std::string merged, error;
+    XmlMergeStats stats;
+    bool ok;
+    {
+        std::ifstream baseIn(base, std::ios::binary);
+        std::ifstream oursIn(ours, std::ios::binary);
+        std::ifstream theirsIn(theirs, std::ios::binary);
+        ok = baseIn && oursIn && theirsIn &&
+             XmlMerge::Merge(baseIn, oursIn, theirsIn, merged, stats, error);
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "ddobuildsync: %s: %s; merging as text\n", path.c_str(),
+                     error.empty() ? "cannot read versions" : error.c_str());
+        ProcessRequest request;
+        request.commandLine = "git merge-file -L ours -L base -L theirs \"" + ours + "\" \"" +
+                              base + "\" \"" + theirs + "\"";
+        ProcessResult result = Process::Run(request);
+        if (!result.output.empty()) std::fprintf(stderr, "%s", result.output.c_str());
+        return result.exitCode == 0 ? 0 : 1;
+    }
+
+    // The merge drops layout, so the file is always written in canonical form
+    ConfigManager configMgr;
+    configMgr.LoadDefault();
+    std::string out;
+    if (XmlCanonical::Canonicalize(merged, out, CanonicalOptionsFor(configMgr.Get()), error)) merged.swap(out);
+
+    std::ofstream f(ours, std::ios::binary | std::ios::trunc);
+    if (!f.is_open() || !f.write(merged.data(), merged.size())) {
+        std::fprintf(stderr, "ddobuildsync: could not write merged %s\n", path.c_str());
+        return 1;
+    }
+    // Conflicting edits are both kept, side by side, for DDO Builder to show
+    if (stats.conflicts > 0) {
+        std::fprintf(stderr, "ddobuildsync: %s merged; %d conflicting change(s) kept from both sides\n",
+                     path.c_str(), stats.conflicts);
+    }
+    return 0;
+}
+
+// The running app answers from its last probe and runs actions in the
+// background, so this never waits on git
+static int ForwardToApp(const std::string& command, bool asJson) {
+    std::string text;
+    if (!CommandChannel::Send(command, text)) {
+        std::fprintf(stderr, "DDOBuildSync is running but did not answer\n");
+        return 1;
+    }
+    json reply;
+    try {
+        reply = json::parse(text);
+    } catch (const json::exception&) {
+        std::fprintf(stderr, "Unexpected reply from DDOBuildSync\n");
+        return 1;
+    }
+
+    bool ok = reply.value("ok", false);
+    if (asJson) {
+        reply["command"] = command;
+        std::cout << reply.dump(2) << "\n";
+    } else if (!ok) {
+        std::fprintf(stderr, "DDOBuildSync: %s\n", reply.value("error", std::string("failed")).c_str());
+    } else if (command == "status") {
+        std::printf("%d changed file(s), %d conflicted, %d ahead, %d behind (as of %s)%s\n",
+                    reply.value("changed_files", -1), reply.value("conflicts", 0),
+                    reply.value("ahead", 0), reply.value("behind", 0),
+                    reply.value("updated_at", std::string("?")).c_str(),
+                    reply.value("busy", false) ? ", sync in progress" : "");
+        for (const auto& name : reply.value("changed_builds", std::vector<std::string>())) {
+            std::printf("  %s\n", name.c_str());
+        }
+    } else {
+        std::printf("%s started in DDOBuildSync\n", command.substr(0, command.find(' ')).c_str());
+    }
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    // git passes the token as-is, which may be empty or start with '-'
+    if (argc >= 2 && std::string(argv[1]) == "fsmonitor") {
+        if (argc != 4) {
+            PrintUsage();
+            return 2;
+        }
+        return RunFsmonitorHook(argv[2], argv[3]);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "merge-driver") {
+        if (argc != 6) {
+            PrintUsage();
+            return 2;
+        }
+        return RunMergeDriver(argv[2], argv[3], argv[4], argv[5]);
+    }
+
+    std::string command;
+    std::vector<std::string> params;   // diff/history/restore operands
+    bool asJson = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            asJson = true;
+        } else if (command.empty() && arg[0] != '-') {
+            command = arg;
+        } else if ((command == "diff" || command == "history" || command == "restore") &&
+                   arg[0] != '-' && params.size() < 2) {
+            params.push_back(arg);
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (command.empty() || (command == "history" && params.size() != 1) ||
+        (command == "restore" && params.size() != 2)) {
+        PrintUsage();
+        return 2;
+    }
+
+    if (command == "canonicalize")   return RunCleanFilter(false);
+    if (command == "filter-process") return RunCleanFilter(true);
+
+    // diff only reads revisions; history reads the index the app keeps
+    // current. Everything that writes to the repo goes through the app.
+    bool appRunning = CommandChannel::InstanceRunning();
+    if (appRunning && command == "restore") return ForwardToApp("restore " + params[1] + " " + params[0], asJson);
+    if (command == "status" || command == "pull" || command == "push" || command == "compact" ||
+        command == "launch" || command == "bundle-sync") {
+        if (appRunning) return ForwardToApp(command, asJson);
+        if (command == "launch") {
+            std::fprintf(stderr, "DDOBuildSync is not running; start it with DDOBuildSync.exe launch\n");
+            return 1;
+        }
+    }
+
+    int rc = 0;
+    int changed = -1;
+    int ahead = 0, behind = 0, conflicts = 0;
+    std::vector<BuildFileDiff> diffs;
+    std::vector<HistoryEntry> history;
+    int squashed = 0;
+    std::string archiveRef;
+
+    if (command == "stats") {
+        // Histograms recorded by the app across its sessions
+        Metrics::LoadFile(Metrics::DefaultPath());
+    } else if (command == "status" || command == "pull" || command == "push" ||
+               command == "bundle-sync" || command == "diff" || command == "history" ||
+               command == "restore" || command == "compact") {
+        ConfigManager configMgr;
+        configMgr.LoadDefault();
+        const SyncConfig& cfg = configMgr.Get();
+        if (cfg.buildsFolder.empty() || !Utils::DirExists(cfg.buildsFolder)) {
+            std::fprintf(stderr, "Builds folder not configured or missing\n");
+            return 1;
+        }
+
+        GitManager git;
+        git.SetWorkDir(cfg.buildsFolder);
+        git.SetRepoUrl(cfg.gitRepoUrl);
+        git.SetMirrorUrls(cfg.mirrorUrls);
+        git.SetRemoteTimeoutMs(cfg.remoteTimeoutSec * 1000);
+        git.SetTrace2Enabled(cfg.gitTrace2Enabled);
+        git.SetCanonicalize(cfg.canonicalizeBuilds, CanonicalOptionsFor(cfg));
+        git.SetSyncRules(SyncRules::FromConfig(cfg));
+        git.SetFsmonitor(cfg.fsmonitorEnabled);
+        git.SetMergeBuilds(cfg.mergeBuilds);
+        git.SetLogCallback([](const std::string& msg) {
+            std::cerr << msg << "\n";
+        });
+
+        if (!git.IsGitAvailable()) {
+            std::fprintf(stderr, "git not found on PATH\n");
+            return 1;
+        }
+        if (!git.IsRepoInitialized()) {
+            std::fprintf(stderr, "Builds folder is not a sync repo yet; run setup from the app\n");
+            return 1;
+        }
+
+        if (command == "status") {
+            ChangeSet changes;
+            if (!git.GetStatus(changes)) {
+                rc = 1;
+            } else {
+                changed = changes.ChangedCount();
+                ahead = changes.ahead;
+                behind = changes.behind;
+                conflicts = changes.unmerged;
+                if (!asJson) {
+                    std::printf("%d changed file(s), %d conflicted, %d ahead, %d behind\n",
+                                changed, conflicts, ahead, behind);
+                    for (const auto& e : changes.entries) {
+                        std::printf("  %c%c %.*s\n", e.index, e.worktree,
+                                    static_cast<int>(e.path.size()), e.path.data());
+                    }
+                }
+            }
+        } else if (command == "diff") {
+            std::string from = params.size() > 0 ? params[0] : "HEAD@{1}";
+            std::string to   = params.size() > 1 ? params[1] : "HEAD";
+            if (!BuildDiff::DiffRevisions(git, from, to, diffs)) {
+                rc = 1;
+            } else if (!asJson) {
+                if (diffs.empty()) std::printf("No build changes\n");
+                for (const auto& d : diffs) {
+                    std::printf("%s\n", BuildDiff::Summary(d).c_str());
+                    for (const auto& c : d.changes) std::printf("%s\n", BuildDiff::Describe(c).c_str());
+                }
+            }
+        } else if (command == "history" || command == "restore") {
+            HistoryIndex& index = git.History();
+            if (command == "history" && appRunning) {
+                // Read-only: the app updates the index after each of its syncs
+            } else if (!index.Update()) {
+                rc = 1;
+            } else if (command == "restore") {
+                rc = index.Restore(params[0], std::atof(params[1].c_str())) ? 0 : 1;
+            } else {
+                history = index.History(params[0]);
+                if (history.empty()) {
+                    std::fprintf(stderr, "No history for %s\n", params[0].c_str());
+                    rc = 1;
+                }
+                for (size_t i = 0; !asJson && i < history.size(); ++i) {
+                    const HistoryEntry& e = history[i];
+                    char stamp[32] = "";
+                    time_t t = static_cast<time_t>(e.time);
+                    struct tm local;
+                    if (localtime_s(&local, &t) == 0) strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M", &local);
+                    std::printf("%c %.8s  %s\n", e.status, e.commit.c_str(), stamp);
+                }
+            }
+        } else if (command == "pull") {
+            rc = git.Pull() ? 0 : 1;
+        } else if (command == "bundle-sync") {
+            if (cfg.bundleDir.empty()) {
+                std::fprintf(stderr, "bundleDir not configured\n");
+                return 1;
+            }
+            BundleSync bundles(git);
+            bundles.SetDirectory(cfg.bundleDir);
+            bundles.SetPeerName(cfg.bundlePeerName);
+            rc = bundles.Sync() ? 0 : 1;
+        } else if (command == "compact") {
+            HistoryCompactor compactor(git);
+            compactor.SetAgeDays(cfg.compactAfterDays);
+            compactor.SetWeekly(cfg.compactPeriod != "day");
+            compactor.SetBundleSync(!cfg.bundleDir.empty());
+            rc = compactor.Run() ? 0 : 1;
+            squashed = compactor.Squashed();
+            archiveRef = compactor.ArchiveRef();
+        } else {
+            rc = git.Push() ? 0 : 1;
+        }
+    } else {
+        PrintUsage();
+        return 2;
+    }
+
+    ProcessUsage self = Process::SelfUsage();
+
+    if (asJson) {
+        json report;
+        report["command"] = command;
+        report["ok"]      = rc == 0;
+        if (command == "status") {
+            report["changed_files"] = changed;
+            report["conflicts"]     = conflicts;
+            report["ahead"]         = ahead;
+            report["behind"]        = behind;
+        }
+        if (command == "compact") {
+            report["squashed"] = squashed;
+            report["archive_ref"] = archiveRef;
+        }
+        if (command == "history") {
+            json commits = json::array();
+            for (const auto& e : history) {
+                commits.push_back({{"commit", e.commit}, {"time", e.time}, {"status", std::string(1, e.status)}});
+            }
+            report["history"] = commits;
+        }
+        if (command == "diff") {
+            json files = json::array();
+            for (const auto& d : diffs) {
+                json f;
+                f["file"]    = d.file;
+                f["added"]   = d.added;
+                f["removed"] = d.removed;
+                if (!d.error.empty()) f["error"] = d.error;
+                json changes = json::array();
+                for (const auto& c : d.changes) {
+                    const char* kind = c.kind == BuildChange::Kind::Added   ? "added"
+                                     : c.kind == BuildChange::Kind::Removed ? "removed" : "changed";
+                    changes.push_back({{"kind", kind}, {"path", c.path}, {"category", BuildDiff::Category(c.path)},
+                                       {"old", c.oldValue}, {"new", c.newValue}});
+                }
+                f["changes"] = changes;
+                files.push_back(f);
+            }
+            report["files"] = files;
+        }
+        report["metrics"] = json::parse(Metrics::ToJson());
+        report["self"]    = UsageToJson(self);
+        std::cout << report.dump(2) << "\n";
+    } else if (command == "stats") {
+        std::string table = Metrics::Format();
+        std::cout << (table.empty() ? "No metrics recorded yet\n" : table);
+        char buf[256];
+        snprintf(buf, sizeof(buf),
+                 "cli: cpu %.0f ms, peak RSS %.1f MB, read %.1f KB, written %.1f KB\n",
+                 self.cpuUserMs + self.cpuKernelMs, self.peakRssBytes / (1024.0 * 1024.0),
+                 self.ioReadBytes / 1024.0, self.ioWriteBytes / 1024.0);
+        std::cout << buf;
+    }
+    return rc;
+}
@@ -0,0 +1,398 @@
+// ddobuildsync_sim - multi-client sync load simulator.
+//
+// Usage: ddobuildsync_sim [--clients N] [--rounds N] [--interval-ms N]
+//                         [--edits N] [--files N] [--max-retries N]
+//                         [--seed N] [--root DIR] [--out report.json] [--keep]
+//                         [--bundles] [--mirrors N] [--merge-builds off|on|both]
+//
+// Creates one local bare repo and N client working copies next to it; client 0
+// seeds it through InitRepo, the rest join through CloneExisting. Every
+// client runs on its own thread: each round it edits a few shared .DDOBuild
+// files, sleeps for the configured interval (with jitter), then syncs through
+// GitManager::Pull/Push exactly like the app's hourly timer. A rejected push
+// is retried after another pull. The report has conflict rate, push retries
+// and p50/p99 sync latency, so intervals and batching can be tuned without
+// touching the production repo.
+//
+// With --bundles, clients sync only through BundleSync on a shared folder
+// under the root after setup, the way offline machines on a LAN would.
+// With --mirrors N, N more bare repos act as mirrors: every push goes to all
+// of them in parallel and pulls come from whichever is fastest.
+// --merge-builds picks whether clients register ddobuildsync_cli as the
+// *.DDOBuild merge driver (it must sit next to this exe). The default,
+// both, runs the same seeded workload twice, driver off then on, and the
+// report has one entry per run so their conflicts can be compared
+// (--keep leaves the last run's repos).
+
+#include "bundle_sync.h"
+#include "git_manager.h"
+#include "utils.h"
+#include <nlohmann/json.hpp>
+#include <windows.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+struct SimOptions {
+    int clients = 4;
+    int rounds = 20;
+    int intervalMs = 500;
+    int editsPerRound = 2;
+    int buildFiles = 50;
+    int maxRetries = 3;
+    unsigned seed = 1;
+    std::string root;
+    std::string outPath;
+    bool keep = false;
+    bool bundles = false;
+    int mirrors = 0;
+    std::vector<bool> mergeBuilds{false, true};   // one run per entry
+};
+
+struct ClientStats {
+    int syncs = 0;
+    int failedSyncs = 0;        // gave up after maxRetries or unresolved conflict
+    int conflicts = 0;          // pull --rebase hit a conflict
+    int keptBoth = 0;           // merge driver kept both sides of an edit
+    int pushRetries = 0;
+    std::vector<double> syncMs;
+};
+
+static void WriteFile(const std::string& path, const std::string& content) {
+    std::ofstream f(path, std::ios::binary);
+    f << content;
+}
+
+static void RemoveTree(const std::string& dir) {
+    std::string cmd = "cmd.exe /C rmdir /S /Q \"" + dir + "\" >nul 2>nul";
+    std::system(cmd.c_str());
+}
+
+static std::string MakeBuildXml(const std::string& name, int revision, const std::string& editor) {
+    std::string x;
+    x += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n";
+    x += "<DDOBuilderCharacterData>\r\n";
+    x += "  <Character>\r\n";
+    x += "    <Name>" + name + "</Name>\r\n";
+    x += "    <Revision>" + std::to_string(revision) + "</Revision>\r\n";
+    x += "    <EditedBy>" + editor + "</EditedBy>\r\n";
+    x += "  </Character>\r\n";
+    x += "</DDOBuilderCharacterData>\r\n";
+    return x;
+}
+
+static double Percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t idx = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+    return v[idx];
+}
+
+// Creates <root>\remote.git plus <root>\client_<i> for every client.
+// Client 0 seeds the remote with the shared build files, the others clone it.
+// Quoted paths of the mirror bare repos, as SetMirrorUrls wants them
+static std::vector<std::string> MirrorUrls(const SimOptions& opt) {
+    std::vector<std::string> urls;
+    for (int m = 0; m < opt.mirrors; ++m) {
+        urls.push_back("\"" + opt.root + "\\mirror_" + std::to_string(m + 1) + ".git\"");
+    }
+    return urls;
+}
+
+static bool SetupRepos(const SimOptions& opt, bool mergeBuilds, std::vector<std::string>& clientDirs) {
+    RemoveTree(opt.root);
+    CreateDirectoryA(opt.root.c_str(), nullptr);
+
+    std::string bare = opt.root + "\\remote.git";
+    std::string output;
+
+    GitManager rootGit;
+    rootGit.SetWorkDir(opt.root);
+    if (rootGit.RunGit("init --bare --initial-branch=main \"" + bare + "\"", output) != 0) {
+        std::fprintf(stderr, "Failed to create bare repo: %s\n", output.c_str());
+        return false;
+    }
+    rootGit.RunGit("-C \"" + bare + "\" config uploadpack.allowFilter true", output);
+    for (const auto& url : MirrorUrls(opt)) {
+        if (rootGit.RunGit("init --bare --initial-branch=main " + url, output) != 0) {
+            std::fprintf(stderr, "Failed to create mirror repo: %s\n", output.c_str());
+            return false;
+        }
+    }
+
+    for (int i = 0; i < opt.clients; ++i) {
+        std::string dir = opt.root + "\\client_" + std::to_string(i);
+        clientDirs.push_back(dir);
+
+        if (i == 0) {
+            CreateDirectoryA(dir.c_str(), nullptr);
+            for (int f = 0; f < opt.buildFiles; ++f) {
+                std::string name = "Char" + std::to_string(f);
+                WriteFile(dir + "\\" + name + ".DDOBuild", MakeBuildXml(name, 0, "seed"));
+            }
+            GitManager git;
+            git.SetWorkDir(dir);
+            git.SetRepoUrl("\"" + bare + "\"");
+            git.SetMirrorUrls(MirrorUrls(opt));
+            git.SetMergeBuilds(mergeBuilds);
+            git.RunGit("init", output);
+            git.RunGit("config user.name sim-client-0", output);
+            git.RunGit("config user.email sim-client-0@localhost", output);
+            if (!git.InitRepo()) {
+                std::fprintf(stderr, "Failed to seed remote from client 0\n");
+                return false;
+            }
+        } else {
+            // Same path as a second machine running Setup. file:// so that
+            // --depth and --filter apply as they would against GitHub.
+            CreateDirectoryA(dir.c_str(), nullptr);
+            std::string url = "file:///" + bare;
+            std::replace(url.begin(), url.end(), '\\', '/');
+            GitManager git;
+            git.SetWorkDir(dir);
+            git.SetRepoUrl("\"" + url + "\"");
+            git.SetMirrorUrls(MirrorUrls(opt));
+            git.SetMergeBuilds(mergeBuilds);
+            if (git.CloneExisting() != CloneResult::Cloned) {
+                std::fprintf(stderr, "Failed to clone client %d\n", i);
+                return false;
+            }
+            std::string id = "sim-client-" + std::to_string(i);
+            git.RunGit("config user.name " + id, output);
+            git.RunGit("config user.email " + id + "@localhost", output);
+        }
+    }
+    return true;
+}
+
+// Pull() failed and left a conflicted merge behind, the same state the app
+// would leave. Keep the local version so the client can keep running.
+static void RecoverKeepLocal(GitManager& git) {
+    std::string output;
+    git.RunGit("merge --abort", output);
+    if (git.RunGit("pull origin main --rebase -X theirs", output) != 0)
+        git.RunGit("rebase --abort", output);
+}
+
+static void RunClient(int id, const SimOptions& opt, bool mergeBuilds, const std::string& dir,
+                      ClientStats& stats) {
+    std::mt19937 rng(opt.seed * 7919u + static_cast<unsigned>(id));
+    std::uniform_int_distribution<int> fileDist(0, opt.buildFiles - 1);
+    std::uniform_int_distribution<int> jitterDist(-opt.intervalMs / 4, opt.intervalMs / 4);
+
+    // GitManager only reports success/failure; conflicts are recognised from
+    // the same log lines the app shows the user
+    bool sawConflict = false;
+    GitManager git;
+    git.SetWorkDir(dir);
+    git.SetMirrorUrls(MirrorUrls(opt));
+    git.SetMergeBuilds(mergeBuilds);
+    git.SetLogCallback([&sawConflict, &stats](const std::string& msg) {
+        if (msg.find("Pull with rebase failed") != std::string::npos) sawConflict = true;
+        if (msg.find("kept from both sides") != std::string::npos) stats.keptBoth++;
+    });
+
+    std::string editor = "client_" + std::to_string(id);
+    std::string output;
+
+    for (int round = 0; round < opt.rounds; ++round) {
+        for (int e = 0; e < opt.editsPerRound; ++e) {
+            std::string name = "Char" + std::to_string(fileDist(rng));
+            WriteFile(dir + "\\" + name + ".DDOBuild", MakeBuildXml(name, round + 1, editor));
+        }
+
+        int sleepMs = (std::max)(0, opt.intervalMs + jitterDist(rng));
+        std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+
+        auto start = std::chrono::steady_clock::now();
+        sawConflict = false;
+
+        if (opt.bundles) {
+            // Commit locally, then swap bundles; there is no push to retry
+            std::string timestamp = Utils::GetTimestamp();
+            git.RunGit("add -A", output);
+            git.RunGit("commit -q -m \"Update builds - " + timestamp + "\"", output);
+            BundleSync bundles(git);
+            bundles.SetDirectory(opt.root + "\\bundles");
+            bundles.SetPeerName(editor);
+            bool synced = bundles.Sync();
+
+            auto end = std::chrono::steady_clock::now();
+            stats.syncs++;
+            if (!synced) stats.failedSyncs++;
+            stats.syncMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            continue;
+        }
+
+        bool ok = git.Pull();
+        if (sawConflict) stats.conflicts++;
+        if (!ok) RecoverKeepLocal(git);
+
+        ok = git.Push();
+        int retries = 0;
+        while (!ok && retries < opt.maxRetries) {
+            // Rejected by the remote: someone pushed in between
+            retries++;
+            sawConflict = false;
+            if (!git.Pull()) RecoverKeepLocal(git);
+            if (sawConflict) stats.conflicts++;
+            // The commit from the failed Push() is already local; push it as is
+            ok = git.RunGit("push origin main", output) == 0;
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        stats.syncs++;
+        stats.pushRetries += retries;
+        if (!ok) stats.failedSyncs++;
+        stats.syncMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+}
+
+// One full simulation (setup, clients, teardown) with the merge driver
+// on or off; fills run with its totals and per-client stats
+static bool RunSimulation(const SimOptions& opt, bool mergeBuilds, json& run) {
+    std::vector<std::string> clientDirs;
+    std::fprintf(stderr, "Setting up %d client(s) in %s (merge driver %s)...\n", opt.clients,
+                 opt.root.c_str(), mergeBuilds ? "on" : "off");
+    if (!SetupRepos(opt, mergeBuilds, clientDirs)) return false;
+
+    std::fprintf(stderr, "Running %d round(s) per client...\n", opt.rounds);
+    std::vector<ClientStats> stats(opt.clients);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < opt.clients; ++i) {
+        threads.emplace_back(RunClient, i, std::cref(opt), mergeBuilds, std::cref(clientDirs[i]),
+                             std::ref(stats[i]));
+    }
+    for (auto& t : threads) t.join();
+    auto end = std::chrono::steady_clock::now();
+
+    ClientStats total;
+    json clients = json::array();
+    for (int i = 0; i < opt.clients; ++i) {
+        const auto& s = stats[i];
+        total.syncs       += s.syncs;
+        total.failedSyncs += s.failedSyncs;
+        total.conflicts   += s.conflicts;
+        total.keptBoth    += s.keptBoth;
+        total.pushRetries += s.pushRetries;
+        total.syncMs.insert(total.syncMs.end(), s.syncMs.begin(), s.syncMs.end());
+
+        json c;
+        c["client"]       = i;
+        c["syncs"]        = s.syncs;
+        c["failed_syncs"] = s.failedSyncs;
+        c["conflicts"]    = s.conflicts;
+        c["kept_both"]    = s.keptBoth;
+        c["push_retries"] = s.pushRetries;
+        c["p50_sync_ms"]  = Percentile(s.syncMs, 0.50);
+        c["p99_sync_ms"]  = Percentile(s.syncMs, 0.99);
+        clients.push_back(c);
+    }
+
+    run["merge_builds"]  = mergeBuilds;
+    run["wall_ms"]       = std::chrono::duration<double, std::milli>(end - start).count();
+    run["syncs"]         = total.syncs;
+    run["failed_syncs"]  = total.failedSyncs;
+    run["conflicts"]     = total.conflicts;
+    run["conflict_rate"] = total.syncs ? static_cast<double>(total.conflicts) / total.syncs : 0.0;
+    run["kept_both"]     = total.keptBoth;
+    run["push_retries"]  = total.pushRetries;
+    run["p50_sync_ms"]   = Percentile(total.syncMs, 0.50);
+    run["p99_sync_ms"]   = Percentile(total.syncMs, 0.99);
+    run["clients"]       = clients;
+
+    if (!opt.keep) RemoveTree(opt.root);
+    return true;
+}
+
+// --merge-builds off|on|both: the runs to make, driver off before on
+static bool ParseMergeBuilds(const std::string& mode, SimOptions& opt) {
+    if      (mode == "off")  opt.mergeBuilds = {false};
+    else if (mode == "on")   opt.mergeBuilds = {true};
+    else if (mode == "both") opt.mergeBuilds = {false, true};
+    else return false;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    SimOptions opt;
+    char tempBuf[MAX_PATH];
+    GetTempPathA(MAX_PATH, tempBuf);
+    opt.root = std::string(tempBuf) + "ddobuildsync_sim";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() { return (i + 1 < argc) ? std::string(argv[++i]) : std::string(); };
+        if      (arg == "--clients")     opt.clients       = (std::max)(1, std::atoi(next().c_str()));
+        else if (arg == "--rounds")      opt.rounds        = (std::max)(1, std::atoi(next().c_str()));
+        else if (arg == "--interval-ms") opt.intervalMs    = (std::max)(0, std::atoi(next().c_str()));
+        else if (arg == "--edits")       opt.editsPerRound = (std::max)(0, std::atoi(next().c_str()));
+        else if (arg == "--files")       opt.buildFiles    = (std::max)(1, std::atoi(next().c_str()));
+        else if (arg == "--max-retries") opt.maxRetries    = (std::max)(0, std::atoi(next().c_str()));
+        else if (arg == "--seed")        opt.seed          = static_cast<unsigned>(std::atoi(next().c_str()));
+        else if (arg == "--root")        opt.root          = next();
+        else if (arg == "--out")         opt.outPath       = next();
+        else if (arg == "--keep")        opt.keep          = true;
+        else if (arg == "--bundles")     opt.bundles       = true;
+        else if (arg == "--mirrors")     opt.mirrors       = (std::max)(0, std::atoi(next().c_str()));
+        else if (arg == "--merge-builds" && ParseMergeBuilds(next(), opt)) {}
+        else {
+            std::fprintf(stderr,
+                "Usage: ddobuildsync_sim [--clients N] [--rounds N] [--interval-ms N]\n"
+                "                        [--edits N] [--files N] [--max-retries N]\n"
+                "                        [--seed N] [--root DIR] [--out report.json] [--keep]\n"
+                "                        [--bundles] [--mirrors N] [--merge-builds off|on|both]\n");
+            return 2;
+        }
+    }
+
+    GitManager probe;
+    if (!probe.IsGitAvailable()) {
+        std::fprintf(stderr, "git not found on PATH\n");
+        return 1;
+    }
+
+    bool wantDriver = std::find(opt.mergeBuilds.begin(), opt.mergeBuilds.end(), true) != opt.mergeBuilds.end();
+    if (wantDriver && !Utils::FileExists(Utils::GetExeDir() + "\\ddobuildsync_cli.exe")) {
+        std::fprintf(stderr, "ddobuildsync_cli.exe not found next to the simulator; "
+                             "runs with the merge driver on would merge as text\n");
+        return 1;
+    }
+
+    json runs = json::array();
+    for (bool mergeBuilds : opt.mergeBuilds) {
+        json run;
+        if (!RunSimulation(opt, mergeBuilds, run)) return 1;
+        runs.push_back(run);
+    }
+
+    json report;
+    report["tool"]      = "ddobuildsync_sim";
+    report["timestamp"] = Utils::GetTimestamp();
+    report["options"] = {
+        {"clients", opt.clients}, {"rounds", opt.rounds}, {"interval_ms", opt.intervalMs},
+        {"edits_per_round", opt.editsPerRound}, {"build_files", opt.buildFiles},
+        {"max_retries", opt.maxRetries}, {"seed", opt.seed}, {"mirrors", opt.mirrors},
+        {"bundles", opt.bundles}
+    };
+    report["runs"] = runs;
+
+    std::string text = report.dump(2);
+    if (opt.outPath.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream f(opt.outPath);
+        f << text << std::endl;
+    }
+
+    return 0;
+}